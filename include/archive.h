@@ -0,0 +1,18 @@
+#pragma once
+
+#include "build.h"
+
+/// @brief Write a thin archive of objects, `cup ar <ar> <archive> <objects...>`.
+/// @note A thin archive only references its members. GNU ar stores the paths of relative members
+///       as given when the archive is named by an absolute path, as CMake does for `target/lib`, so
+///       the objects are passed to ar by absolute path instead.
+class ThinArchive : public SubCommand
+{
+    std::string ar;
+    fs::path archive;
+    std::vector<fs::path> objects;
+
+public:
+    ThinArchive(const cmd::Args &args);
+    int run() override;
+};
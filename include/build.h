@@ -6,6 +6,7 @@
 #include <memory>
 #include "plugin/loader.h"
 #include "toml/dependency.h"
+#include "toml/profile.h"
 #include <iostream>
 #include <fstream>
 namespace fs = std::filesystem;
@@ -31,10 +32,14 @@ struct VersionInfo
 struct CMakeOutBlock
 {
     std::string name;
-    std::string content;
-    std::string content_global;
+    /// The script generated for the package, relative to the build directory.
+    fs::path script;
+    /// The script to include before `project()`, unless the plugin generated nothing for it.
+    std::optional<fs::path> script_global;
     VersionInfo version;
     fs::path path;
+    /// The options of `[profile.<mode>]` for a dependency, added to the targets of its script.
+    std::vector<std::string> profile;
 };
 
 class CMakeOutContent
@@ -43,8 +48,8 @@ class CMakeOutContent
 
 public:
     void push(const CMakeOutBlock &block);
-    void write_to(std::ofstream &os);
-    void write_global_to(std::ofstream &os);
+    void write_to(std::ostream &os);
+    void write_global_to(std::ostream &os);
 };
 
 struct FromParent
@@ -53,6 +58,25 @@ struct FromParent
     fs::path root_dir;
 };
 
+/// @brief A package of the dependency graph.
+struct PackageNode
+{
+    CMakeContext ctx;
+    bool is_dependency{false};
+    std::string type;
+    CMakeOutBlock block;
+    /// Identifies the package with the root and the features it is resolved with, unique in the graph.
+    std::string key;
+    /// (name in the manifest, index) of each enabled dependency.
+    std::vector<std::pair<std::string, size_t>> dependencies;
+    /// A digest of the inputs, set once the block is generated.
+    std::string digest;
+    /// Why the block was reused or generated again.
+    std::string explanation;
+    /// The scripts of the package were rewritten.
+    bool changed{false};
+};
+
 class Build : public SubCommand
 {
     std::string generator;
@@ -61,8 +85,49 @@ class Build : public SubCommand
     std::string name;
     CMakeOutContent output;
     std::vector<std::string> cycle_check;
+    std::vector<fs::path> packages;
+    /// The names of `packages`.
+    std::vector<std::string> package_names;
+    bool generated{false};
+    bool explain{false};
+    bool timings{false};
+    /// The backend selected by `[build] backend`.
+    std::string backend{"cmake"};
+    /// The public headers of the libraries are linked into one tree, `[build] include_layout`.
+    bool unified_includes{false};
+    /// Static libraries only reference their objects, `[build] thin_archives`.
+    bool thin_archives{false};
+    /// The settings of the dependencies in the build type, `[profile.<mode>]` of the root project.
+    std::optional<data::Profile> profile;
+    /// The build files are written for ninja directly instead of CMake.
+    bool ninja{false};
+    /// Packages whose scripts were rewritten.
+    std::vector<std::string> changed;
 
-    void generate_cmake(const fs::path &cup, const std::optional<FromParent> &info = std::nullopt);
+    /// @brief Parse the manifests of a package and its dependencies.
+    /// @param nodes The packages resolved so far, dependencies first.
+    /// @param resolved The index of each resolved package by its directory and features.
+    /// @return The index of the package in `nodes`.
+    size_t resolve(const fs::path &cup, const std::optional<FromParent> &info, std::vector<PackageNode> &nodes,
+                   std::unordered_map<std::string, size_t> &resolved);
+    /// @brief Get the options of the profile for a dependency.
+    /// @param name The name of the project of the dependency.
+    std::vector<std::string> profile_options(const std::string &name) const;
+    /// @brief Generate the block of a package whose dependencies are generated.
+    void generate_package(PackageNode &node, const std::vector<PackageNode> &nodes);
+    /// @brief Generate the blocks of all packages, independent packages concurrently.
+    void generate_cmake(std::vector<PackageNode> &nodes);
+    /// @brief Write the build files of the ninja backend.
+    /// @return `false` if the graph needs CMake, in which case nothing is written.
+    bool generate_ninja(const std::vector<PackageNode> &nodes);
+    void configure();
+    void export_compile_commands();
+    /// @brief Get the compiler launcher, as a CMake list which is also a shell command.
+    /// @return The launcher, or an empty string to compile locally.
+    std::string launcher() const;
+    /// @brief Print the compile time report and merge the traces of the build.
+    void report_time_trace();
+    void print_timings(const std::vector<std::pair<std::string, double>> &phases);
 protected:
     bool is_release{false};
     fs::path root;
@@ -70,10 +135,28 @@ protected:
     std::optional<std::string> command;
     std::optional<fs::path> compile_commands;
     std::vector<std::string> languages;
+    /// Run the plugins which are not built into cup out of process.
+    bool isolate{false};
+    /// Compile on the workers of `cup worker`.
+    bool distribute{false};
+    /// Report the compile time of the build from the traces of Clang.
+    bool time_trace{false};
+    /// Write full static libraries even if `[build] thin_archives` is set, to ship them.
+    bool full_archives{false};
 
 public:
     Build(const cmd::Args &args);
     int run() override;
+
+    /// @brief Identify the generated build script: the project and the build type.
+    /// @return A key which is equal for builds producing the same `CMakeLists.txt`.
+    std::string generation_key() const;
+    /// @brief Get the root directories of all packages visited by the generation.
+    /// @return The package directories, dependencies first.
+    const std::vector<fs::path> &get_packages() const;
+    /// @brief Reuse the generation of a previous build instead of generating again.
+    /// @param other A build of the same project whose inputs have not changed since.
+    void reuse_generation(const Build &other);
 };
 
 std::pair<fs::path, std::string> get_path(const data::Dependency &dep, bool download = true,
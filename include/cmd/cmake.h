@@ -16,6 +16,8 @@ namespace cmd
         CMake &source(const fs::path &source_dir);
         CMake &build_dir(const fs::path &build_dir);
         CMake &generator(const std::string &generator);
+        /// @brief Load a script populating the cache before the first configuration.
+        CMake &initial_cache(const fs::path &script);
 
         CMake &target(const std::string &target);
         CMake &build(const fs::path &build_dir);
@@ -24,5 +26,8 @@ namespace cmd
         CMake &jobs(int num_jobs = std::thread::hardware_concurrency());
 
         std::string as_command() const;
+
+        /// @brief Get the version of the installed CMake, such as `3.28.1`.
+        static const std::string &version();
     };
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <optional>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace cmd
+{
+    /// @brief A GNU make jobserver shared by every build process started by cup.
+    /// @note If `MAKEFLAGS` already advertises a jobserver (e.g. cup is run by `make -j`),
+    ///       cup joins it as a client. Otherwise cup serves a fifo-based one itself.
+    ///       An outer jobserver advertised by file descriptors is not joined when the fifo
+    ///       form is required, cup then serves a fifo sized by the `-j` of the outer make.
+    ///       Child processes find the jobserver through the `MAKEFLAGS` environment variable.
+    class JobServer
+    {
+        fs::path fifo;
+        int fd{-1};
+        int wfd{-1};
+        bool client{false};
+        std::string old_makeflags;
+        bool had_makeflags{false};
+
+    public:
+        /// @brief Join the inherited jobserver, or create one holding `jobs` slots.
+        /// @param dir The directory where the fifo is created.
+        /// @param jobs The total number of jobs allowed to run at the same time. The `-j` of
+        ///             the outer make takes precedence when its jobserver cannot be joined.
+        /// @param fifo_auth Advertise the fifo by path (GNU make 4.4+, Ninja) instead of by
+        ///                  inherited file descriptors (GNU make 4.0+). If set, an inherited
+        ///                  jobserver is only joined when it is advertised by fifo too.
+        JobServer(const fs::path &dir, int jobs, bool fifo_auth = false);
+        ~JobServer();
+        JobServer(const JobServer &) = delete;
+        JobServer &operator=(const JobServer &) = delete;
+
+        /// @brief Check whether the jobserver is inherited from a parent process.
+        /// @return `true` if cup is a client of an outer jobserver.
+        bool is_client() const;
+        /// @brief Check whether a jobserver is advertised by `MAKEFLAGS`.
+        /// @return `true` if a usable jobserver is inherited.
+        static bool inherited();
+        /// @brief Get the pipe of a jobserver advertised by file descriptors in `MAKEFLAGS`.
+        /// @return The read and write descriptors, or nothing if they are not inherited.
+        static std::optional<std::pair<int, int>> descriptors();
+        /// @brief Check whether the build tool behind the generator can use a jobserver.
+        /// @param generator The CMake generator.
+        /// @return `true` if the build tool draws its jobs from a jobserver.
+        static bool supported(const std::string &generator);
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <optional>
+#include <filesystem>
+#include <unordered_map>
+namespace fs = std::filesystem;
+
+namespace cmd
+{
+    /// @brief An external tool found in `PATH`.
+    struct Tool
+    {
+        std::string name;
+        fs::path path;
+        /// The version reported by `<tool> --version`, such as `3.28.1`.
+        std::string version;
+
+        /// @brief Check whether the version is at least `major.minor`.
+        bool at_least(int major, int minor) const;
+        /// @brief Check whether the tool supports a feature, such as `jobserver` for `ninja`.
+        /// @note The capabilities of each tool are derived from its version.
+        bool has(const std::string &capability) const;
+    };
+
+    /// @brief The external tools used by cup, such as `cmake`, `git` and `ninja`.
+    /// @note Tools are looked up by scanning `PATH`. Their versions are cached in
+    ///       `~/.cup/cache/tools.cache` by path and modification time, so that a tool is only
+    ///       run to query its version once it is installed or updated.
+    class ToolRegistry
+    {
+        struct Entry
+        {
+            fs::path path;
+            std::string mtime;
+            std::string version;
+        };
+        std::mutex mutex;
+        bool loaded{false};
+        /// The versions of the cache file, by tool name.
+        std::unordered_map<std::string, Entry> cache;
+        /// The tools looked up by this process.
+        std::unordered_map<std::string, std::optional<Tool>> tools;
+
+        ToolRegistry() = default;
+        void load();
+        void save() const;
+
+    public:
+        ToolRegistry(const ToolRegistry &) = delete;
+        ToolRegistry &operator=(const ToolRegistry &) = delete;
+
+        /// @brief Get the registry of the process.
+        static ToolRegistry &instance();
+
+        /// @brief Find an executable in `PATH`.
+        /// @param name The name of the executable, without extension.
+        /// @return The path of the executable, or nothing if it is not found.
+        static std::optional<fs::path> which(const std::string &name);
+
+        /// @brief Get an installed tool.
+        /// @param name The name of the tool.
+        /// @return The tool, or nothing if it is not installed or does not run.
+        std::optional<Tool> find(const std::string &name);
+        /// @brief Get an installed tool.
+        /// @param name The name of the tool.
+        /// @return The tool.
+        /// @throw std::runtime_error If the tool is not installed.
+        Tool require(const std::string &name);
+    };
+}
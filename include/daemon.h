@@ -0,0 +1,31 @@
+#pragma once
+
+#include "build.h"
+
+/// @brief A background process which keeps the generation of a project warm.
+/// @note The daemon listens on a Unix socket under `target/`. `cup build` and `cup run`
+///       forward their command line to it when it is running, and it reuses the previous
+///       generation until inotify reports a change of a manifest or of a source file list.
+///       A request carries the working directory and the environment of the client, along with
+///       its standard streams and the pipe of its jobserver. Requests from an environment with
+///       other compilers or `PATH` are refused, and the client closing the connection cancels
+///       the build.
+class Daemon : public SubCommand
+{
+    fs::path root;
+    bool detach{false};
+    bool stop{false};
+
+    int serve(int sock);
+
+public:
+    Daemon(const cmd::Args &args);
+    int run() override;
+
+    /// @brief Forward a `build` or `run` command line to the daemon of the project.
+    /// @param args The parsed command line.
+    /// @param argc The number of raw arguments.
+    /// @param argv The raw arguments.
+    /// @return The exit code of the command, or nothing if no daemon is running.
+    static std::optional<int> forward(const cmd::Args &args, int argc, char **argv);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+#include "cup_plugin/interface.h"
+#include "plugin/cacheable.h"
+namespace fs = std::filesystem;
+
+/// @brief The inputs of the generation of a package.
+/// @note A generated block is only reused if every input is unchanged.
+struct Fingerprint
+{
+    /// Hash of the manifest.
+    std::string manifest;
+    /// The enabled features and the enabled dependencies.
+    std::string features;
+    /// Source files of the package, relative to the package.
+    std::vector<std::string> sources;
+    /// `<name> <digest>` of each dependency.
+    std::vector<std::string> dependencies;
+    /// Identity of the plugin which generates the block: its type, version and cache key.
+    std::string plugin;
+    /// `<kind> <name> <hash>` of each input declared by the plugin.
+    std::vector<std::string> inputs;
+    /// Hash of the remaining context, such as the root directory.
+    std::string context;
+
+    /// @brief Collect the inputs of the generation of a package.
+    /// @param ctx The context passed to the plugin.
+    /// @param is_dependency Whether the package is a dependency.
+    /// @param type The project type of the package.
+    /// @param inputs The inputs declared by the plugin.
+    /// @param dependencies `<name> <digest>` of each dependency.
+    static Fingerprint of(const CMakeContext &ctx, bool is_dependency, const std::string &type,
+                          const PluginInputs &inputs, std::vector<std::string> dependencies);
+
+    /// @brief Get a hash of all the inputs.
+    std::string digest() const;
+    /// @brief Describe the inputs which differ from a previous fingerprint.
+    /// @param old The previous fingerprint.
+    /// @return One line for each changed input.
+    std::vector<std::string> diff(const Fingerprint &old) const;
+
+    /// @brief Hash a string with 64-bit FNV-1a.
+    /// @return The hash as hexadecimal digits.
+    static std::string hash(const std::string &data);
+
+    /// @brief Load a fingerprint saved by `save`.
+    /// @param file The fingerprint file.
+    /// @return The fingerprint, or nothing if the file is missing or malformed.
+    static std::optional<Fingerprint> load(const fs::path &file);
+    /// @brief Save the fingerprint.
+    /// @param file The fingerprint file.
+    void save(const fs::path &file) const;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "build.h"
+
+/// @brief Write the interface stub of a shared library, `cup ifs <library> <stub>`.
+/// @note The stub is a text of what linking against the library depends on: its `SONAME`, the
+///       libraries it needs and its exported dynamic symbols, with their type, binding, version
+///       and, for data, size. It is only written when it changes, so that the consumers of the
+///       library, which depend on the stub instead of the library, are relinked only when the
+///       interface of the library changes. Libraries which are not ELF files get a digest of the
+///       whole file instead.
+class InterfaceStub : public SubCommand
+{
+    fs::path library;
+    fs::path stub;
+
+public:
+    InterfaceStub(const cmd::Args &args);
+    int run() override;
+
+    /// @brief Get the stub of a shared library.
+    static std::string of(const fs::path &library);
+};
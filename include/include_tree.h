@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+/// @brief The unified include tree of a build, selected with `[build] include_layout = "unified"`.
+/// @note Every library adds its public include directory to the search path of its consumers, so
+///       a target deep in the graph searches one directory per library for each `#include`. The
+///       top-level entries of the public directories are linked into `target/build/include`
+///       instead, which replaces them all. A directory is only merged if none of its entries is
+///       already provided by another one, so each header still resolves to the same file.
+class IncludeTree
+{
+public:
+    /// @brief Get the directory of the tree.
+    static fs::path directory(const fs::path &root);
+
+    /// @brief Link the public directories into the tree, and remove the links of the last build
+    ///        which are no longer valid.
+    /// @param root The root directory of the project.
+    /// @param dirs (package directory, public include directory) of each library, in the order of the
+    ///             build. An empty list removes the tree.
+    /// @return The packages whose public directory is merged.
+    static std::vector<fs::path> sync(const fs::path &root, const std::vector<std::pair<fs::path, fs::path>> &dirs);
+
+    /// @brief Check whether the public directory of a package is merged into the tree.
+    /// @param root The root directory of the project.
+    /// @param package The directory of the package.
+    static bool contains(const fs::path &root, const fs::path &package);
+
+    /// @brief Get the directory to search for the public headers of a package.
+    /// @return The tree if the package is merged into it, otherwise `dir`.
+    static fs::path public_dir(const fs::path &root, const fs::path &package, const fs::path &dir);
+};
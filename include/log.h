@@ -1,8 +1,23 @@
 #pragma once
 #include <iostream>
+#include <sstream>
+#include <mutex>
 
+inline std::mutex &log_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+/// @brief Print a line. Lines printed by different threads are not interleaved.
 template <typename... Args>
-void log_print(Args &&...args) { (std::cout << ... << args) << std::endl; }
+void log_print(Args &&...args)
+{
+    std::ostringstream oss;
+    (oss << ... << args) << "\n";
+    std::lock_guard lock(log_mutex());
+    std::cout << oss.str() << std::flush;
+}
 
 #ifdef _DEBUG
 #define LOG_DEBUG(...) log_print("\033[32m[DEBUG]", __VA_ARGS__, "\033[0m")
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+#include "build.h"
+namespace fs = std::filesystem;
+
+/// @brief Write `build.ninja` for the package graph directly, without CMake.
+/// @note Experimental, selected with `[build] backend = "ninja"` in the root manifest. Only
+///       graphs of `binary`, `static` and `interface` packages with C and C++ sources are
+///       supported, built with a GCC-compatible compiler. The settings of the manifests are
+///       merged in the same order as the templates of the built-in plugins. Each package is
+///       written to its own `<name>-<hash>.ninja`, included by `build.ninja` with `subninja`,
+///       and files are only rewritten when their content changes.
+class NinjaBackend
+{
+public:
+    /// @brief The settings of a target, merged from the tables of a manifest.
+    struct Flags
+    {
+        std::vector<std::string> includes;
+        std::vector<std::string> link_dirs;
+        std::vector<std::string> libs;
+        std::vector<std::string> defines;
+        std::vector<std::string> compile_options;
+        std::vector<std::string> link_options;
+        std::vector<fs::path> sources;
+
+        void append(const Flags &other);
+    };
+
+    /// @brief A package of the graph, with the settings of the manifest merged.
+    struct Package
+    {
+        std::string name;
+        std::string type;
+        /// `<name>-<hash>`, naming the subninja file and the object directory.
+        std::string stem;
+        /// `<name>_<version>`, as in the target names of the built-in plugins.
+        std::string unique;
+        fs::path dir;
+        bool is_dependency{false};
+        /// The settings of the package itself. Private settings only apply to its own sources.
+        Flags flags;
+        Flags private_flags;
+        /// Only the settings of `[build.public]` are usage requirements, including its defines.
+        bool public_table{false};
+        std::vector<fs::path> sources;
+        std::optional<fs::path> main_file;
+        std::vector<fs::path> test_mains;
+        std::vector<fs::path> example_mains;
+        Flags tests;
+        Flags examples;
+        std::string stdc;
+        std::string stdcxx;
+        /// The options of `[profile.<mode>]` for a dependency, after those of the package.
+        std::vector<std::string> profile;
+        /// Indices of the dependencies, in the order of the manifest.
+        std::vector<size_t> dependencies;
+        /// The static library built by the package.
+        std::optional<std::string> archive;
+        /// The header generated for `[build] config_header`, which holds `config_defines`.
+        std::optional<fs::path> config_header;
+        std::vector<std::string> config_defines;
+    };
+
+private:
+    fs::path root;
+    bool is_release;
+    std::string launcher;
+    bool thin_archives;
+    fs::path dir;
+    std::vector<Package> packages;
+    std::vector<std::string> changed_;
+
+    std::optional<std::string> collect(const std::vector<PackageNode> &nodes);
+    std::string write_package(const Package &package, std::vector<std::string> &defaults) const;
+
+public:
+    /// @param root The root directory of the project.
+    /// @param is_release Whether the build type is `release`.
+    /// @param launcher The command prefixed to the compilations, if any.
+    /// @param thin_archives Whether the static libraries only reference their objects.
+    NinjaBackend(const fs::path &root, bool is_release, const std::string &launcher = "", bool thin_archives = false);
+
+    /// @brief Get the directory of `build.ninja`.
+    static fs::path directory(const fs::path &root);
+
+    /// @brief Write the build files of a package graph.
+    /// @param nodes The resolved packages, dependencies first.
+    /// @return Why the graph cannot be built without CMake, or nothing if the files are written.
+    std::optional<std::string> generate(const std::vector<PackageNode> &nodes);
+    /// @brief Get the packages whose files were rewritten by the last generation.
+    const std::vector<std::string> &changed() const { return changed_; }
+};
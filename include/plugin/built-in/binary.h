@@ -1,8 +1,8 @@
 #include "cup_plugin/interface.h"
+#include "plugin/cacheable.h"
 
-class BinaryPlugin : public IPlugin
+class BinaryPlugin : public IPlugin, public ICacheable
 {
-    void _get_source_files(const fs::path &src, std::vector<fs::path> &files);
     std::vector<fs::path> get_source_files(const fs::path &root);
     fs::path get_main_file(const fs::path &root);
     std::vector<fs::path> get_bin_main_files(const fs::path &root);
@@ -15,4 +15,5 @@ public:
     Result<fs::path, std::string> run_project(const RunProjectData &data) override;
     Result<std::optional<std::string>, std::string> get_target(const RunProjectData &data) const override;
     Result<int, std::string> show_help(const cmd::Args &command) const override;
+    Result<PluginInputs, std::string> declare_inputs(const CMakeContext &ctx, bool is_dependency) const override;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "cup_plugin/interface.h"
+#include "plugin/cacheable.h"
 
-class InterfacePlugin : public IPlugin
+class InterfacePlugin : public IPlugin, public ICacheable
 {
     std::vector<fs::path> get_all_tests_main_files(const fs::path &root);
     std::vector<fs::path> get_examples_main_files(const fs::path &root);
@@ -11,4 +12,5 @@ public:
     Result<fs::path, std::string> run_project(const RunProjectData &data) override;
     Result<std::optional<std::string>, std::string> get_target(const RunProjectData &data) const override;
     Result<int, std::string> show_help(const cmd::Args &command) const override;
+    Result<PluginInputs, std::string> declare_inputs(const CMakeContext &ctx, bool is_dependency) const override;
 };
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include "cup_plugin/interface.h"
+#include "toml/build.h"
+#include <optional>
+
+/// @brief Remove what a generated script spends on configuration that does not exist.
+/// @note Variables which are only ever set to nothing, and the option lists of the templates
+///       which are never set, such as `TARGET_MODE_LIBS`, are dropped along with every reference
+///       to them. Then the commands, `if()` branches and `foreach()` loops left without
+///       arguments or bodies are dropped. Other variables, which may be set outside of the
+///       script, are kept, so the result configures as the original script.
+/// @param script A script generated by a built-in plugin.
+/// @return The reduced script.
+std::string lean_cmake(const std::string &script);
+
+/// @brief Check whether `[build] codegen` asks for lean scripts.
+/// @return `false` for "full", the default.
+/// @exception std::runtime_error If the value is neither "full" nor "lean".
+bool lean_codegen(const std::optional<data::Build> &build);
+
+/// @brief Record whether a project asks for lean scripts, `[build] codegen = "lean"`.
+/// @param root The root directory of the project.
+/// @param lean Whether the root manifest selects lean scripts.
+/// @note Called by `Build::resolve`, which reads the root manifest once for every package.
+void set_lean(const fs::path &root, bool lean);
+
+/// @brief Check whether the root project asks for lean scripts.
+/// @param ctx The context of the generation.
+/// @note The root manifest is only read if `set_lean` was not called for the project.
+bool lean_enabled(const CMakeContext &ctx);
@@ -1,8 +1,8 @@
 #include "cup_plugin/interface.h"
+#include "plugin/cacheable.h"
 
-class ModulePlugin : public IPlugin
+class ModulePlugin : public IPlugin, public ICacheable
 {
-    void _get_all_source_files(const fs::path &root, std::vector<fs::path> &src_files);
     std::vector<fs::path> get_all_source_files(const fs::path &root);
     std::vector<fs::path> get_test_main_files(const fs::path &root);
 public:
@@ -12,4 +12,5 @@ public:
     Result<fs::path, std::string> run_project(const RunProjectData &data) override;
     Result<std::optional<std::string>, std::string> get_target(const RunProjectData &data) const override;
     Result<int, std::string> show_help(const cmd::Args &command) const override;
+    Result<PluginInputs, std::string> declare_inputs(const CMakeContext &ctx, bool is_dependency) const override;
 };
\ No newline at end of file
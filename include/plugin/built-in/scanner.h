@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <unordered_map>
+namespace fs = std::filesystem;
+
+/// @brief A scanner of source trees shared by the built-in plugins.
+/// @note Directories are walked in parallel, by a number of helper threads bounded for the whole
+///       process. Entries matched by a `.gitignore` of the package or of its parent directories
+///       or by the `[build] exclude` patterns of its manifest are skipped. The listing of every
+///       directory is cached by its modification time, so unchanged trees are not read again.
+class SourceScanner
+{
+public:
+    /// @brief A pattern in the syntax of `.gitignore`.
+    struct Rule
+    {
+        /// The directory which the pattern is relative to, as a generic path ending with `/`.
+        std::string base;
+        std::string pattern;
+        bool negate{false};
+        bool dir_only{false};
+        /// The pattern is matched against the whole relative path instead of the file name.
+        bool anchored{false};
+    };
+    using Rules = std::vector<Rule>;
+
+private:
+    struct Listing
+    {
+        fs::file_time_type::rep mtime{};
+        std::vector<std::string> files;
+        std::vector<std::string> dirs;
+    };
+    using ListingPtr = std::shared_ptr<const Listing>;
+    struct PackageRules
+    {
+        /// The modification times of the manifest and of the ignore files.
+        std::vector<fs::file_time_type::rep> stamps;
+        std::shared_ptr<const Rules> rules;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, ListingPtr> listings;
+    std::unordered_map<std::string, PackageRules> packages;
+    bool dirty{false};
+    /// The threads helping the scans of the process, whichever package they belong to.
+    std::atomic<unsigned> helpers{0};
+
+    SourceScanner() = default;
+    ListingPtr list(const fs::path &dir);
+    std::shared_ptr<const Rules> rules_of(const fs::path &root);
+    /// @brief Reserve a helper thread for a scan.
+    /// @return `false` if the helpers of all the scans already use every core but one.
+    bool acquire_helper();
+
+public:
+    SourceScanner(const SourceScanner &) = delete;
+    SourceScanner &operator=(const SourceScanner &) = delete;
+
+    /// @brief Get the scanner of the process.
+    static SourceScanner &instance();
+
+    /// @brief List the source files in a directory of a package.
+    /// @param root The root directory of the package.
+    /// @param dir The directory to scan.
+    /// @param recursive Scan the subdirectories as well.
+    /// @return The source files in a stable order, or nothing if `dir` does not exist.
+    std::vector<fs::path> scan(const fs::path &root, const fs::path &dir, bool recursive = true);
+
+    /// @brief List the files matching a pattern.
+    /// @param root The directory which the pattern is relative to.
+    /// @param pattern A pattern in the syntax of `.gitignore`, matched against the whole relative path.
+    /// @return The matching files in a stable order.
+    std::vector<fs::path> expand(const fs::path &root, const std::string &pattern);
+
+    /// @brief Load the listings cached by a previous run.
+    /// @param file The cache file.
+    void load(const fs::path &file);
+    /// @brief Save the cached listings if any of them changed.
+    /// @param file The cache file.
+    void save(const fs::path &file);
+
+    /// @brief Parse a line of a `.gitignore` file.
+    /// @param line The line.
+    /// @param base The directory which the pattern is relative to.
+    /// @param rules The rules to append to.
+    static void parse_rule(const std::string &line, const fs::path &base, Rules &rules);
+    /// @brief Check whether a path is ignored by the rules.
+    /// @param rules The rules, later rules take precedence.
+    /// @param path The path to check.
+    /// @param is_dir Whether the path is a directory.
+    static bool ignored(const Rules &rules, const fs::path &path, bool is_dir);
+};
@@ -1,8 +1,8 @@
 #include "cup_plugin/interface.h"
+#include "plugin/cacheable.h"
 
-class StaticPlugin : public IPlugin
+class StaticPlugin : public IPlugin, public ICacheable
 {
-    void _get_source_files(const fs::path &dir, std::vector<fs::path> &src_files) const;
     std::vector<fs::path> get_source_files(const fs::path &root) const;
     std::vector<fs::path> get_test_mains(const fs::path &root) const;
     std::vector<fs::path> get_example_mains(const fs::path &root) const;
@@ -13,4 +13,5 @@ public:
     Result<fs::path, std::string> run_project(const RunProjectData &data) override;
     Result<std::optional<std::string>, std::string> get_target(const RunProjectData &data) const override;
     Result<int, std::string> show_help(const cmd::Args &command) const override;
+    Result<PluginInputs, std::string> declare_inputs(const CMakeContext &ctx, bool is_dependency) const override;
 };
\ No newline at end of file
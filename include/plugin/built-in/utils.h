@@ -1,14 +1,24 @@
 #pragma once
 
 #include "cup_plugin/interface.h"
+#include "plugin/cacheable.h"
+#include "plugin/loader.h"
+#include "plugin/built-in/lean.h"
 #include "utils/utils.h"
+#include "toml/build.h"
+#include "template.h"
+#include "res.h"
+#include "include_tree.h"
+#include "cmd/tools.h"
+#include <cctype>
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
+#include <iterator>
 
-inline void _cycle_dep_check(const std::string &key, const std::map<std::string, std::vector<std::string>> &table)
+inline void _cycle_dep_check(const std::string &key, const std::map<std::string, std::vector<std::string>> &table,
+                             std::vector<std::string> &cycle_check)
 {
-    static std::vector<std::string> cycle_check;
     auto has_cycle = std::find(cycle_check.begin(), cycle_check.end(), key) != cycle_check.end();
     cycle_check.push_back(key);
     if (has_cycle)
@@ -19,7 +29,7 @@ inline void _cycle_dep_check(const std::string &key, const std::map<std::string,
     if (!table.contains(key))
         throw std::runtime_error("Feature '" + key + "' not found in [features]");
     for (const auto &value : table.at(key))
-        _cycle_dep_check(value, table);
+        _cycle_dep_check(value, table, cycle_check);
     cycle_check.pop_back();
 }
 
@@ -28,7 +38,10 @@ inline void cycle_dep_check(const std::optional<std::map<std::string, std::vecto
     if (!table)
         return;
     for (const auto &[key, _] : *table)
-        _cycle_dep_check(key, *table);
+    {
+        std::vector<std::string> cycle_check;
+        _cycle_dep_check(key, *table, cycle_check);
+    }
 }
 
 inline std::vector<std::string> get_features(
@@ -113,11 +126,106 @@ std::unordered_map<std::string, std::string> gen_map(const std::string &prefix,
     };
 }
 
+/// @brief Turn a package name into an upper case identifier, as in the macros of its export header.
+inline std::string macro_name(const std::string &name)
+{
+    std::string result;
+    for (auto c : name)
+        result += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : '_';
+    return result;
+}
+
 inline std::string dealpath(const fs::path &p)
 {
     return '"' + replace(p.string()) + '"';
 }
 
+/// @brief Get the path of `[build] config_header`, checked to stay inside its include directory.
+inline std::optional<fs::path> config_header_of(const std::optional<data::Build> &build)
+{
+    if (!build || !build->config_header)
+        return std::nullopt;
+    auto header = build->config_header->lexically_normal();
+    if (header.empty() || header.is_absolute() || *header.begin() == "..")
+        throw std::runtime_error("'config_header' must be a relative path: " + build->config_header->string());
+    return header;
+}
+
+/// @brief Generate the script which moves the defines of a package into `[build] config_header`.
+/// @param build The `[build]` table of the package.
+/// @param root The root directory of the project being built.
+/// @param unique The unique name of the package, `<name>_<version>`.
+/// @return The script, or nothing if the package has no config header.
+/// @note The header is generated in `target/build/config/<unique>`, which is added to the include directories.
+inline std::string gen_config_header(const std::optional<data::Build> &build, const fs::path &root,
+                                     const std::string &unique)
+{
+    auto header = config_header_of(build);
+    if (!header)
+        return "";
+    return FileTemplate{
+#include "template/cmake/config.cmake"
+        ,
+        {
+            {"CONFIG_HEADER_DIR", dealpath(Resource::build(root) / "config" / unique)},
+            {"CONFIG_HEADER", header->generic_string()},
+        }}
+        .getContent();
+}
+
+/// @brief Generate the script setting the usage requirements of `[build.public]` of a library.
+/// @param build The `[build]` table of the package.
+/// @return The script, which clears the requirements if the package has no such table.
+/// @note With the table, the other settings of the library become private, see `VISIBILITY`.
+inline std::string gen_public(const std::optional<data::Build> &build)
+{
+    auto table = build ? build->public_data : std::nullopt;
+    std::unordered_map<std::string, std::string> replacements;
+    {
+        auto extend = gen_map("PUBLIC_", table);
+        replacements.insert(extend.begin(), extend.end());
+    }
+    {
+        auto extend = gen_map("PUBLIC_DEBUG_", table ? table->debug : std::nullopt);
+        replacements.insert(extend.begin(), extend.end());
+    }
+    {
+        auto extend = gen_map("PUBLIC_RELEASE_", table ? table->release : std::nullopt);
+        replacements.insert(extend.begin(), extend.end());
+    }
+    return FileTemplate{
+#include "template/cmake/public.cmake"
+        ,
+        replacements}
+        .getContent();
+}
+
+/// @brief Check whether `[build] visibility` hides the symbols of a library which are not exported.
+inline bool hidden_visibility(const std::optional<data::Build> &build)
+{
+    if (!build || !build->visibility || *build->visibility == "default")
+        return false;
+    if (*build->visibility != "hidden")
+        throw std::runtime_error("Unknown visibility '" + *build->visibility + "', expected 'default' or 'hidden'.");
+    return true;
+}
+
+/// @brief Generate the header defining the export macros of a library, `<MACRO>_EXPORT` and `<MACRO>_NO_EXPORT`.
+/// @param name The name of the package, which names the macros.
+/// @param exporting The condition under which the header is compiled into the library itself.
+inline std::string gen_visibility_header(const std::string &name, const std::string &exporting)
+{
+    return FileTemplate{
+#include "template/visibility.h.txt"
+        ,
+        {
+            {"NAME", name},
+            {"MACRO", macro_name(name)},
+            {"EXPORTING", exporting},
+        }}
+        .getContent();
+}
+
 inline std::unordered_map<std::string, std::string> gen_feat_replacement(const std::vector<std::string> &name)
 {
     static const std::vector<std::string> suffix = {
@@ -179,4 +287,72 @@ inline bool is_source_file(const fs::path &p)
         ".ispc",
     };
     return suffix.contains(p.extension().string());
-}
\ No newline at end of file
+}
+
+/// @brief Check whether a source is a C++20 module interface unit, by its extension.
+inline bool is_module_unit(const fs::path &p)
+{
+    static const std::unordered_set<std::string> suffix = {".cppm", ".ixx", ".ccm", ".cxxm", ".c++m", ".mpp"};
+    return suffix.contains(p.extension().string());
+}
+
+/// @brief Move the module interface units out of the sources of a package.
+/// @return The module interface units.
+inline std::vector<fs::path> take_module_units(std::vector<fs::path> &sources)
+{
+    std::vector<fs::path> units;
+    std::copy_if(sources.begin(), sources.end(), std::back_inserter(units), is_module_unit);
+    std::erase_if(sources, is_module_unit);
+    return units;
+}
+
+/// @brief Generate the script adding the module interface units of a package to a `CXX_MODULES` file set.
+/// @param name The name of the package.
+/// @param units The module interface units, under `base_dir`.
+/// @param base_dir The directory which the units are found in.
+/// @param target The target owning the units.
+/// @param library Whether `target` is a static library to create, which is appended to `LIBS`.
+/// @return The script, or nothing if the package has no module interface units.
+/// @throw std::runtime_error If the installed CMake cannot scan the dependencies of modules.
+inline std::string gen_modules(const std::string &name, const std::vector<fs::path> &units, const fs::path &base_dir,
+                               const std::string &target, bool library)
+{
+    if (units.empty())
+        return "";
+    if (auto cmake = cmd::ToolRegistry::instance().find("cmake"); cmake && !cmake->has("cxx-modules"))
+        throw std::runtime_error("The C++ modules of " + name + " need CMake 3.28 or newer, found " + cmake->version + ".");
+    auto for_library = library ? FileTemplate{
+#include "template/cmake/module_library.cmake"
+                                     ,
+                                     {{"TARGET", target}}}
+                                     .getContent()
+                               : "";
+    return FileTemplate{
+#include "template/cmake/modules.cmake"
+        ,
+        {
+            {"NAME", name},
+            {"FOR_LIBRARY", for_library},
+            {"TARGET", target},
+            {"BASE_DIR", dealpath(base_dir)},
+            {"MODULE_SOURCES", join(units, " ", dealpath)},
+        }}
+        .getContent();
+}
+
+/// @brief Declare the inputs of a built-in plugin, which only reads the inputs cup always tracks.
+inline Result<PluginInputs, std::string> built_in_inputs(const CMakeContext &ctx)
+{
+    auto version = PluginLoader::built_in_version();
+    if (!version)
+        return Err<PluginInputs>(std::string("Cannot identify the cup executable."));
+    // The root manifest selects the code generation of every package, and whether the public
+    // headers of the package are found in the unified include tree.
+    std::vector<std::string> keys;
+    if (lean_enabled(ctx))
+        keys.push_back("lean");
+    if (IncludeTree::contains(ctx.root_dir, ctx.current_dir))
+        keys.push_back("unified");
+    auto key = keys.empty() ? std::nullopt : std::optional<std::string>(join(keys, " "));
+    return Ok<std::string>(PluginInputs{.files = {}, .globs = {}, .env = {}, .version = *version, .cache_key = key});
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "cup_plugin/interface.h"
+
+#ifdef _WIN32
+#define CUP_EXTENSION_EXPORT extern "C" __declspec(dllexport)
+#else
+#define CUP_EXTENSION_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+/// @brief The inputs which the output of `gen_cmake` and `gen_cmake_global` depends on,
+///        besides the manifest, the features, the source files and the dependencies of the package.
+struct PluginInputs
+{
+    /// Files whose content is read. Relative paths are relative to the package.
+    std::vector<fs::path> files;
+    /// Patterns relative to the package, in the syntax of `.gitignore`, whose matching files are read.
+    std::vector<std::string> globs;
+    /// Environment variables which are read.
+    std::vector<std::string> env;
+    /// The version of the plugin. It must change whenever the output of the plugin may change.
+    std::string version;
+    /// An additional key computed by the plugin.
+    std::optional<std::string> cache_key;
+};
+
+/// @brief An optional extension of `IPlugin` for plugins whose generation can be cached.
+/// @note cup reuses the blocks generated by such a plugin while none of the declared inputs
+///       has changed, without calling `gen_cmake` or `gen_cmake_global`. A plugin loaded from a
+///       shared library exposes the extension with `CUP_CACHEABLE_PLUGIN(<plugin class>)`.
+///       Plugins which do not implement it are called on every build.
+class ICacheable
+{
+public:
+    virtual ~ICacheable() = default;
+    /// @brief Declare the inputs of the generation of a package.
+    /// @param ctx The context which will be passed to `gen_cmake`.
+    /// @param is_dependency Whether the package is a dependency.
+    /// @return The inputs, or an error if the generation cannot be cached this time.
+    virtual Result<PluginInputs, std::string> declare_inputs(const CMakeContext &ctx, bool is_dependency) const = 0;
+};
+
+/// @brief Export the `ICacheable` extension of a plugin class from its shared library.
+#define CUP_CACHEABLE_PLUGIN(PluginType)                          \
+    CUP_EXTENSION_EXPORT ICacheable *cacheablePlugin(IPlugin *plugin) \
+    {                                                             \
+        return static_cast<PluginType *>(plugin);                 \
+    }
+
+/// @brief Declare that the plugin of a shared library may generate several packages at once.
+/// @note `declare_inputs`, `gen_cmake` and `gen_cmake_global` of such a plugin are called
+///       concurrently from different threads. Calls to other plugins are serialized.
+#define CUP_THREAD_SAFE_PLUGIN                  \
+    CUP_EXTENSION_EXPORT bool threadSafePlugin() \
+    {                                           \
+        return true;                            \
+    }
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+#include "cup_plugin/interface.h"
+#include "plugin/cacheable.h"
+
+/// @brief A plugin running in a child process, `cup plugin-host <type> <fd>`.
+/// @note The child loads the plugin and answers requests over a socket pair. Every message is
+///       a frame: a 32-bit little-endian length followed by the payload. A request starts with
+///       an `Op`, a response with a status byte, 1 for success and 0 for an error message.
+///       A crash of the plugin only fails the request being served.
+class PluginHost : public IPlugin, public ICacheable
+{
+public:
+    enum class Op : uint8_t
+    {
+        GenCMake = 1,
+        GenCMakeGlobal = 2,
+        GetTarget = 3,
+        RunProject = 4,
+        DeclareInputs = 5,
+    };
+
+    /// @brief The payload of a frame.
+    class Frame
+    {
+        std::string data;
+        size_t offset{0};
+
+    public:
+        Frame() = default;
+        Frame(std::string data) : data(std::move(data)) {}
+        const std::string &bytes() const { return data; }
+
+        Frame &put(uint8_t value);
+        Frame &put(uint32_t value);
+        Frame &put(const std::string &value);
+        Frame &put(const std::vector<std::string> &value);
+        Frame &put(const std::optional<std::string> &value);
+        Frame &put(const CMakeContext &ctx);
+        Frame &put(const RunProjectData &data);
+
+        uint8_t get_u8();
+        uint32_t get_u32();
+        std::string get_string();
+        std::vector<std::string> get_strings();
+        std::optional<std::string> get_optional();
+        CMakeContext get_context();
+        RunProjectData get_run_data();
+    };
+
+private:
+    std::string type;
+    int fd{-1};
+    int pid{-1};
+    bool cacheable_{false};
+    /// The child exited or the connection broke, so the host cannot be reused.
+    mutable bool broken{false};
+
+    Frame call(const Frame &request) const;
+
+public:
+    /// @brief Start a host for a plugin.
+    /// @param type The project type handled by the plugin.
+    PluginHost(const std::string &type);
+    ~PluginHost();
+    PluginHost(const PluginHost &) = delete;
+    PluginHost &operator=(const PluginHost &) = delete;
+
+    const std::string &plugin_type() const { return type; }
+    /// @brief Check whether the plugin implements `ICacheable`.
+    bool cacheable() const { return cacheable_; }
+    /// @brief Check whether the host can serve more requests.
+    bool alive() const { return !broken; }
+
+    Result<std::string, std::string> getName() const override;
+    Result<int, std::string> run_new(const NewData &data) override;
+    Result<std::string, std::string> gen_cmake(const CMakeContext &ctx, bool is_dependency) override;
+    Result<std::string, std::string> gen_cmake_global(const CMakeContext &ctx, bool is_dependency) override;
+    Result<fs::path, std::string> run_project(const RunProjectData &data) override;
+    Result<std::optional<std::string>, std::string> get_target(const RunProjectData &data) const override;
+    Result<int, std::string> show_help(const cmd::Args &command) const override;
+    Result<PluginInputs, std::string> declare_inputs(const CMakeContext &ctx, bool is_dependency) const override;
+
+    /// @brief Serve the requests of the parent process until it closes the connection.
+    /// @param type The project type handled by the plugin.
+    /// @param fd The end of the socket pair inherited from the parent.
+    /// @return The exit code of the host.
+    static int serve(const std::string &type, int fd);
+};
+
+/// @brief The idle plugin hosts of the process.
+/// @note A host serves one request at a time, so concurrent generations of packages using
+///       the same plugin are spread over several hosts.
+class PluginHostPool
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<std::unique_ptr<PluginHost>>> idle;
+
+    PluginHostPool() = default;
+
+public:
+    PluginHostPool(const PluginHostPool &) = delete;
+    PluginHostPool &operator=(const PluginHostPool &) = delete;
+
+    /// @brief Get the pool of the process.
+    static PluginHostPool &instance();
+
+    /// @brief Take an idle host of a plugin, starting one if there is none.
+    /// @param type The project type handled by the plugin.
+    std::unique_ptr<PluginHost> acquire(const std::string &type);
+    /// @brief Return a host to the pool. Broken hosts are discarded.
+    void release(std::unique_ptr<PluginHost> host);
+};
@@ -15,20 +15,95 @@ using DLLPtr = void *;
 #define DLL_GET_FUNC(dll, func) (func = (decltype(func))dlsym(dll, #func))
 #endif
 #include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
 #include "cup_plugin/interface.h"
+#include "plugin/cacheable.h"
+#include "plugin/host.h"
 
-class PluginLoader
+/// @brief The plugins loaded by the process.
+/// @note Each plugin is loaded and instantiated once, on first use, and unloaded at exit.
+class PluginRegistry
 {
     using CreatePluginFunc = IPlugin *(*)();
     using DestroyPluginFunc = void (*)(IPlugin *);
-    DLLPtr dll{nullptr};
+    using CacheablePluginFunc = ICacheable *(*)(IPlugin *);
+    using ThreadSafePluginFunc = bool (*)();
+    struct Entry
+    {
+        DLLPtr dll{nullptr};
+        IPlugin *plugin{nullptr};
+        /// The `ICacheable` extension of the plugin, if it implements one.
+        ICacheable *cacheable{nullptr};
+        DestroyPluginFunc destroyPlugin{nullptr};
+        /// Serializes the calls to a plugin which is not thread-safe.
+        std::shared_ptr<std::mutex> lock;
+        /// Time spent loading and instantiating the plugin, in milliseconds.
+        double load_time{0};
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> plugins;
+    /// Plugin types in the order they were loaded.
+    std::vector<std::string> order;
+
+    PluginRegistry() = default;
+    Entry load(const std::string &type);
+
+public:
+    ~PluginRegistry();
+    PluginRegistry(const PluginRegistry &) = delete;
+    PluginRegistry &operator=(const PluginRegistry &) = delete;
+
+    /// @brief Get the registry of the process.
+    static PluginRegistry &instance();
+
+    /// @brief Get the instance of a plugin, loading it if necessary.
+    /// @param type The project type handled by the plugin.
+    IPlugin *get(const std::string &type);
+    /// @brief Get the `ICacheable` extension of a plugin, loading it if necessary.
+    /// @param type The project type handled by the plugin.
+    /// @return The extension, or `nullptr` if the plugin does not implement it.
+    ICacheable *cacheable(const std::string &type);
+    /// @brief Get the mutex serializing the calls to a plugin, loading it if necessary.
+    /// @param type The project type handled by the plugin.
+    /// @return The mutex, or `nullptr` if the plugin is thread-safe.
+    std::shared_ptr<std::mutex> lock_of(const std::string &type);
+    /// @brief Get the load time of each loaded plugin.
+    /// @return (type, milliseconds) in the order the plugins were loaded.
+    std::vector<std::pair<std::string, double>> load_times();
+};
+
+/// @brief A handle to a plugin of the registry.
+class PluginLoader
+{
     IPlugin *plugin{nullptr};
-    CreatePluginFunc createPlugin{nullptr};
-    DestroyPluginFunc destroyPlugin{nullptr};
+    ICacheable *extension{nullptr};
+    std::shared_ptr<std::mutex> lock;
+    /// The host leased from the pool while the plugin runs out of process.
+    std::unique_ptr<PluginHost> host;
 
 public:
-    PluginLoader(const std::string &type);
+    /// @param type The project type handled by the plugin.
+    /// @param isolate Run a plugin which is not built into cup in a `PluginHost`.
+    PluginLoader(const std::string &type, bool isolate = false);
     ~PluginLoader();
+    PluginLoader(const PluginLoader &) = delete;
+    PluginLoader &operator=(const PluginLoader &) = delete;
 
     IPlugin *operator->() { return plugin; }
+    /// @brief Get the `ICacheable` extension of the plugin.
+    /// @return The extension, or `nullptr` if the plugin does not implement it.
+    ICacheable *cacheable() { return extension; }
+    /// @brief Acquire the plugin for a generation.
+    /// @return A lock held while calling the plugin, which is empty if the plugin is thread-safe.
+    std::unique_lock<std::mutex> acquire() { return lock ? std::unique_lock(*lock) : std::unique_lock<std::mutex>(); }
+
+    /// @brief Check whether a project type is handled by a plugin built into cup.
+    static bool is_built_in(const std::string &type);
+    /// @brief Get the version of the built-in plugins, which changes with the cup executable.
+    /// @return The version, or nothing if the executable cannot be identified.
+    static std::optional<std::string> built_in_version();
 };
\ No newline at end of file
@@ -24,10 +24,19 @@ public:
     /// @brief Get the packages directory of the user.
     /// @return The packages directory of the user.
     static fs::path packages();
+    /// @brief Get the directory of the toolchain snapshots of the user.
+    /// @return The toolchains directory of the user.
+    static fs::path toolchains();
+    /// @brief Get the directory where the compile workers listen.
+    /// @return The workers directory of the user.
+    static fs::path workers();
     /// @brief Get the content of the cache file.
     /// @param file_name The name of the cache file.
     /// @return The content of the cache file.
     static std::string read_cache(const std::string& file_name);
+    /// @brief Get the path of the running cup executable.
+    /// @return The path, or an empty path if it cannot be determined.
+    static fs::path executable();
 
     static fs::path target(const fs::path& root);
     static fs::path cmake(const fs::path& root);
@@ -36,6 +45,7 @@ public:
     static fs::path dll(const fs::path& root);
     static fs::path mod(const fs::path& root);
     static fs::path build(const fs::path& root);
+    static fs::path socket(const fs::path& root);
     static std::pair<fs::path, std::string> repo_dir(const std::string& url,
          const std::optional<std::string>& version, bool download = true);
 };
\ No newline at end of file
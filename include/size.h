@@ -0,0 +1,26 @@
+#pragma once
+
+#include "subcmd.h"
+
+/// @brief Report where the bytes of the built artifacts come from, `cup size`.
+/// @note The ELF section and symbol tables of the artifacts are read directly, static libraries
+///       member by member. The size of each symbol is attributed to a package: by the static
+///       library defining it, by the source file it was compiled from, and otherwise by its
+///       outermost namespace. Instantiations of the same template are grouped to show template
+///       bloat. Artifacts in other formats are skipped.
+class Size : public Run
+{
+    bool save{false};
+    size_t top{10};
+    fs::path baseline_file;
+
+    /// @brief Get the artifacts to report: the selected target, or every built one.
+    std::vector<fs::path> artifacts();
+
+public:
+    Size(const cmd::Args &args);
+    int run() override;
+
+    /// @brief Get the file which `--save` writes the sizes to.
+    static fs::path baseline(const fs::path &root);
+};
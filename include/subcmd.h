@@ -28,6 +28,19 @@ class Run : public Build
 {
     std::string args;
 
+    RunProjectData project_data() const;
+    std::string project_type() const;
+
+protected:
+    /// @brief Build the target selected by the command line.
+    void build_target();
+    /// @brief Get the artifact of the target selected by the command line.
+    /// @return The absolute path given by the builder plugin.
+    fs::path get_artifact();
+    /// @brief Get the command line which runs the built target.
+    /// @return The executable followed by the arguments given by `--args`.
+    std::string get_executable();
+
 public:
     Run(const cmd::Args &args);
     int run() override;
@@ -77,4 +90,14 @@ class Clean : public SubCommand
 public:
     Clean(const cmd::Args &args);
     int run() override;
-};
\ No newline at end of file
+};
+/// @brief Serve a plugin to the cup process which started it.
+class PluginHostMode : public SubCommand
+{
+    std::string type;
+    int fd;
+
+public:
+    PluginHostMode(const cmd::Args &args);
+    int run() override;
+};
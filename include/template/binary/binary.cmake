@@ -27,6 +27,8 @@ set(COPTIONS ${TARGET_COPTIONS} ${TARGET_MODE_COPTIONS} ${M_COPTIONS} ${MODE_COP
 set(LINKOPTIONS ${TARGET_LINKOPTIONS} ${TARGET_MODE_LINKOPTIONS} ${M_LINKOPTIONS} ${MODE_LINKOPTIONS} ${GEN_LINKOPTIONS} ${GEN_MODE_LINKOPTIONS} ${FEAT_LINKOPTIONS})
 set(EXT_SOURCES ${TARGET_SOURCES} ${TARGET_MODE_SOURCES} ${M_SOURCES} ${MODE_SOURCES} ${GEN_SOURCES} ${GEN_MODE_SOURCES} ${FEAT_SOURCES})
 set(COMPILER_FEAT ${TARGET_COMPILER_FEAT} ${TARGET_MODE_COMPILER_FEAT} ${M_COMPILER_FEAT} ${MODE_COMPILER_FEAT} ${GEN_COMPILER_FEAT} ${GEN_MODE_COMPILER_FEAT} ${FEAT_COMPILER_FEAT})
+${%FOR_CONFIG%}
+${%FOR_MODULES%}
 set(UNIQUE_NAME "${OUT_NAME}_${UNIQUE}")
 
 add_executable(${UNIQUE_NAME} ${SOURCES} ${MAIN_FILE})
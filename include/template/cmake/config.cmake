@@ -0,0 +1,17 @@
+R"(#"
+# The defines are written to the config header instead of the command lines, so that only the
+# sources including it are rebuilt when they change. The header is only rewritten on changes.
+set(CONFIG_HEADER_DIR ${%CONFIG_HEADER_DIR%})
+set(CONFIG_HEADER_CONTENT "// Generated by cup, do not edit.\n#pragma once\n")
+foreach(DEFINE ${DEFINES})
+    string(REGEX REPLACE "^-D" "" DEFINE "${DEFINE}")
+    if(DEFINE MATCHES "^([^=]+)=(.*)$")
+        string(APPEND CONFIG_HEADER_CONTENT "#define ${CMAKE_MATCH_1} ${CMAKE_MATCH_2}\n")
+    else()
+        string(APPEND CONFIG_HEADER_CONTENT "#define ${DEFINE} 1\n")
+    endif()
+endforeach()
+file(GENERATE OUTPUT "${CONFIG_HEADER_DIR}/${%CONFIG_HEADER%}" CONTENT "${CONFIG_HEADER_CONTENT}")
+set(DEFINES)
+list(APPEND INCLUDE_DIRS ${CONFIG_HEADER_DIR})
+#)"
\ No newline at end of file
@@ -0,0 +1,15 @@
+R"(#"
+# The targets of the package cannot own the units, they are built by a static library linked to them.
+add_library(${%TARGET%} STATIC)
+target_include_directories(${%TARGET%} PRIVATE ${INCLUDE_DIRS})
+target_link_directories(${%TARGET%} PRIVATE ${LIB_DIRS})
+target_link_libraries(${%TARGET%} PRIVATE ${LIBS})
+target_compile_definitions(${%TARGET%} PRIVATE ${DEFINES})
+target_compile_options(${%TARGET%} PRIVATE ${COPTIONS})
+if(${STDCXX})
+set_target_properties(${%TARGET%} PROPERTIES
+    CXX_STANDARD ${STDCXX}
+    CXX_STANDARD_REQUIRED ON)
+endif()
+list(APPEND LIBS ${%TARGET%})
+#)"
\ No newline at end of file
@@ -0,0 +1,14 @@
+R"(#"
+# The module interface units are compiled once into BMIs, which CMake passes to the importers.
+# Dependency scanning needs CMake 3.28 and a generator writing dynamic dependencies.
+if(CMAKE_VERSION VERSION_LESS 3.28 OR NOT CMAKE_GENERATOR MATCHES "Ninja|Visual Studio")
+    message(FATAL_ERROR "The C++ modules of ${%NAME%} need CMake 3.28 or newer with a Ninja or Visual Studio generator.")
+endif()
+${%FOR_LIBRARY%}
+target_sources(${%TARGET%} PUBLIC
+    FILE_SET CXX_MODULES
+    BASE_DIRS ${%BASE_DIR%}
+    FILES ${%MODULE_SOURCES%})
+target_compile_features(${%TARGET%} PUBLIC cxx_std_20)
+set_target_properties(${%TARGET%} PROPERTIES CXX_SCAN_FOR_MODULES ON)
+#)"
\ No newline at end of file
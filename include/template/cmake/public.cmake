@@ -0,0 +1,29 @@
+R"(#"
+
+set(PUB_INCLUDE_DIRS ${%PUBLIC_INCLUDE_DIRS%})
+set(PUB_LIB_DIRS ${%PUBLIC_LIB_DIRS%})
+set(PUB_LIBS ${%PUBLIC_LIBS%})
+set(PUB_DEFINES ${%PUBLIC_DEFINES%})
+set(PUB_COPTIONS ${%PUBLIC_COPTIONS%})
+set(PUB_LINKOPTIONS ${%PUBLIC_LINKOPTIONS%})
+set(PUB_COMPILER_FEAT ${%PUBLIC_COMPILER_FEAT%})
+
+if(${CMAKE_BUILD_TYPE} STREQUAL "Debug")
+    set(PUB_MODE_INCLUDE_DIRS ${%PUBLIC_DEBUG_INCLUDE_DIRS%})
+    set(PUB_MODE_LIB_DIRS ${%PUBLIC_DEBUG_LIB_DIRS%})
+    set(PUB_MODE_LIBS ${%PUBLIC_DEBUG_LIBS%})
+    set(PUB_MODE_DEFINES ${%PUBLIC_DEBUG_DEFINES%})
+    set(PUB_MODE_COPTIONS ${%PUBLIC_DEBUG_COPTIONS%})
+    set(PUB_MODE_LINKOPTIONS ${%PUBLIC_DEBUG_LINKOPTIONS%})
+    set(PUB_MODE_COMPILER_FEAT ${%PUBLIC_DEBUG_COMPILER_FEAT%})
+else()
+    set(PUB_MODE_INCLUDE_DIRS ${%PUBLIC_RELEASE_INCLUDE_DIRS%})
+    set(PUB_MODE_LIB_DIRS ${%PUBLIC_RELEASE_LIB_DIRS%})
+    set(PUB_MODE_LIBS ${%PUBLIC_RELEASE_LIBS%})
+    set(PUB_MODE_DEFINES ${%PUBLIC_RELEASE_DEFINES%})
+    set(PUB_MODE_COPTIONS ${%PUBLIC_RELEASE_COPTIONS%})
+    set(PUB_MODE_LINKOPTIONS ${%PUBLIC_RELEASE_LINKOPTIONS%})
+    set(PUB_MODE_COMPILER_FEAT ${%PUBLIC_RELEASE_COMPILER_FEAT%})
+endif()
+
+#)"
\ No newline at end of file
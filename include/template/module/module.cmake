@@ -10,6 +10,7 @@ set(DEPS ${%DEPS%})
 set(INC ${%INC%})
 set(STDC ${%STDC%})
 set(STDCXX ${%STDCXX%})
+set(HIDDEN ${%HIDDEN%})
 
 ${%FOR_GEN%}
 ${%FOR_MODE%}
@@ -25,6 +26,7 @@ set(COPTIONS ${TARGET_COPTIONS} ${TARGET_MODE_COPTIONS} ${M_COPTIONS} ${MODE_COP
 set(LINKOPTIONS ${TARGET_LINKOPTIONS} ${TARGET_MODE_LINKOPTIONS} ${M_LINKOPTIONS} ${MODE_LINKOPTIONS} ${GEN_LINKOPTIONS} ${GEN_MODE_LINKOPTIONS} ${FEAT_LINKOPTIONS})
 set(EXT_SOURCES ${TARGET_SOURCES} ${TARGET_MODE_SOURCES} ${M_SOURCES} ${MODE_SOURCES} ${GEN_SOURCES} ${GEN_MODE_SOURCES} ${FEAT_SOURCES})
 set(COMPILER_FEAT ${TARGET_COMPILER_FEAT} ${TARGET_MODE_COMPILER_FEAT} ${M_COMPILER_FEAT} ${MODE_COMPILER_FEAT} ${GEN_COMPILER_FEAT} ${GEN_MODE_COMPILER_FEAT} ${FEAT_COMPILER_FEAT})
+${%FOR_CONFIG%}
 set(UNIQUE_NAME "${OUT_NAME}_${UNIQUE}")
 
 add_library(${UNIQUE_NAME} MODULE ${SOURCES})
@@ -49,6 +51,12 @@ set_target_properties(${UNIQUE_NAME} PROPERTIES
     CXX_STANDARD ${STDCXX}
     CXX_STANDARD_REQUIRED ON)
 endif()
+if(${HIDDEN})
+set_target_properties(${UNIQUE_NAME} PROPERTIES
+    C_VISIBILITY_PRESET hidden
+    CXX_VISIBILITY_PRESET hidden
+    VISIBILITY_INLINES_HIDDEN ON)
+endif()
 
 foreach(TEST_MAIN_FILE ${TEST_MAIN_FILES})
     get_filename_component(TEST_NAME ${TEST_MAIN_FILE} NAME_WLE)
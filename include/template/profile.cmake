@@ -0,0 +1,20 @@
+R"( #"
+# Add the options of `[profile.<mode>]` to the targets created since BEFORE was read from
+# BUILDSYSTEM_TARGETS. They come after the options of the targets, so they take precedence.
+# The options are those of GCC and Clang, MSVC cannot optimize with the /RTC1 of Debug builds.
+function(cup_apply_profile BEFORE)
+    if(MSVC)
+        return()
+    endif()
+    get_property(TARGETS DIRECTORY PROPERTY BUILDSYSTEM_TARGETS)
+    if(BEFORE)
+        list(REMOVE_ITEM TARGETS ${BEFORE})
+    endif()
+    foreach(TARGET ${TARGETS})
+        get_target_property(TYPE ${TARGET} TYPE)
+        if(TYPE MATCHES "^(STATIC_LIBRARY|SHARED_LIBRARY|MODULE_LIBRARY|OBJECT_LIBRARY|EXECUTABLE)$")
+            target_compile_options(${TARGET} PRIVATE ${ARGN})
+        endif()
+    endforeach()
+endfunction()
+# )"
@@ -13,10 +13,12 @@ set(EXPORT_INC ${%EXPORT_INC%})
 set(SOURCES ${%SOURCES%})
 set(STDC ${%STDC%})
 set(STDCXX ${%STDCXX%})
+set(VISIBILITY ${%VISIBILITY%})
 set(OUT_DIR ${%OUT_DIR%})
 
 ${%FOR_GEN%}
 ${%FOR_MODE%}
+${%FOR_PUBLIC%}
 ${%FOR_TESTS%}
 ${%FOR_EXAMPLES%}
 ${%FOR_FEAT%}
@@ -30,17 +32,32 @@ set(COPTIONS ${TARGET_COPTIONS} ${TARGET_MODE_COPTIONS} ${M_COPTIONS} ${MODE_COP
 set(LINKOPTIONS ${TARGET_LINKOPTIONS} ${TARGET_MODE_LINKOPTIONS} ${M_LINKOPTIONS} ${MODE_LINKOPTIONS} ${GEN_LINKOPTIONS} ${GEN_MODE_LINKOPTIONS} ${FEAT_LINKOPTIONS})
 set(EXT_SOURCES ${TARGET_SOURCES} ${TARGET_MODE_SOURCES} ${M_SOURCES} ${MODE_SOURCES} ${GEN_SOURCES} ${GEN_MODE_SOURCES} ${FEAT_SOURCES})
 set(COMPILER_FEAT ${TARGET_COMPILER_FEAT} ${TARGET_MODE_COMPILER_FEAT} ${M_COMPILER_FEAT} ${MODE_COMPILER_FEAT} ${GEN_COMPILER_FEAT} ${GEN_MODE_COMPILER_FEAT} ${FEAT_COMPILER_FEAT})
+set(PUBLIC_INCLUDE_DIRS ${PUB_INCLUDE_DIRS} ${PUB_MODE_INCLUDE_DIRS})
+set(PUBLIC_LIB_DIRS ${PUB_LIB_DIRS} ${PUB_MODE_LIB_DIRS})
+set(PUBLIC_LIBS ${PUB_LIBS} ${PUB_MODE_LIBS})
+set(PUBLIC_DEFINES ${PUB_DEFINES} ${PUB_MODE_DEFINES})
+set(PUBLIC_COPTIONS ${PUB_COPTIONS} ${PUB_MODE_COPTIONS})
+set(PUBLIC_LINKOPTIONS ${PUB_LINKOPTIONS} ${PUB_MODE_LINKOPTIONS})
+set(PUBLIC_COMPILER_FEAT ${PUB_COMPILER_FEAT} ${PUB_MODE_COMPILER_FEAT})
+${%FOR_CONFIG%}
 
 add_library(${EXPORT_NAME} STATIC ${SOURCES})
 target_sources(${EXPORT_NAME} PRIVATE ${EXT_SOURCES})
-target_compile_features(${EXPORT_NAME} PUBLIC ${COMPILER_FEAT})
-target_include_directories(${EXPORT_NAME} PUBLIC ${INCLUDE_DIRS})
+target_compile_features(${EXPORT_NAME} ${VISIBILITY} ${COMPILER_FEAT})
+target_compile_features(${EXPORT_NAME} PUBLIC ${PUBLIC_COMPILER_FEAT})
+target_include_directories(${EXPORT_NAME} ${VISIBILITY} ${INCLUDE_DIRS})
+target_include_directories(${EXPORT_NAME} PUBLIC ${EXPORT_INC} ${PUBLIC_INCLUDE_DIRS})
 target_include_directories(${EXPORT_NAME} PRIVATE ${INC})
-target_link_directories(${EXPORT_NAME} PUBLIC ${LIB_DIRS})
-target_link_libraries(${EXPORT_NAME} PUBLIC ${LIBS})
+target_link_directories(${EXPORT_NAME} ${VISIBILITY} ${LIB_DIRS})
+target_link_directories(${EXPORT_NAME} PUBLIC ${PUBLIC_LIB_DIRS})
+target_link_libraries(${EXPORT_NAME} ${VISIBILITY} ${LIBS})
+target_link_libraries(${EXPORT_NAME} PUBLIC ${PUBLIC_LIBS})
 target_compile_definitions(${EXPORT_NAME} PRIVATE ${DEFINES})
-target_compile_options(${EXPORT_NAME} PUBLIC ${COPTIONS})
-target_link_options(${EXPORT_NAME} PUBLIC ${LINKOPTIONS})
+target_compile_definitions(${EXPORT_NAME} PUBLIC ${PUBLIC_DEFINES})
+target_compile_options(${EXPORT_NAME} ${VISIBILITY} ${COPTIONS})
+target_compile_options(${EXPORT_NAME} PUBLIC ${PUBLIC_COPTIONS})
+target_link_options(${EXPORT_NAME} ${VISIBILITY} ${LINKOPTIONS})
+target_link_options(${EXPORT_NAME} PUBLIC ${PUBLIC_LINKOPTIONS})
 set_target_properties(${EXPORT_NAME} PROPERTIES
     OUTPUT_NAME ${EXPORT_NAME}
     ARCHIVE_OUTPUT_DIRECTORY ${OUT_DIR})
@@ -54,6 +71,7 @@ set_target_properties(${EXPORT_NAME} PROPERTIES
     CXX_STANDARD ${STDCXX}
     CXX_STANDARD_REQUIRED ON)
 endif()
+${%FOR_MODULES%}
 
 if(NOT ${IS_DEP})
     foreach(TEST_MAIN_FILE ${TEST_MAIN_FILES})
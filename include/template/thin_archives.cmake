@@ -0,0 +1,9 @@
+R"( #"
+# Thin archives reference the objects instead of copying them, GNU ar and llvm-ar write them.
+if(CMAKE_EXECUTABLE_FORMAT STREQUAL "ELF")
+    foreach(LANG C CXX ASM CUDA)
+        set(CMAKE_${LANG}_ARCHIVE_CREATE "${CUP_AR_COMMAND} <CMAKE_AR> <TARGET> <OBJECTS>")
+        set(CMAKE_${LANG}_ARCHIVE_APPEND "${CUP_AR_COMMAND} <CMAKE_AR> <TARGET> <OBJECTS>")
+    endforeach()
+endif()
+# )"
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "toml_serde/trait.h"
-#include "toml/default/part.h"
+#include "toml/default/parts.h"
 #include "toml/export.h"
 
 namespace data
@@ -26,6 +26,15 @@ namespace data
         std::optional<Array<std::string>> features;
         std::optional<Export> export_data;
         std::optional<Array<std::string>> languages;
+        std::optional<Array<std::string>> exclude;
+        std::optional<std::string> codegen;
+        std::optional<std::string> backend;
+        std::optional<std::string> include_layout;
+        std::optional<std::string> visibility;
+        std::optional<bool> thin_archives;
+        std::optional<fs::path> config_header;
+        /// The usage requirements of a library, which make the other settings private.
+        std::optional<Parts> public_data;
     };
 
     TOML_DESERIALIZE(Build, {
@@ -46,5 +55,13 @@ namespace data
         TOML_OPTIONS(features);
         _TOML_OPTIONS(export_data, "export");
         TOML_OPTIONS(languages);
+        TOML_OPTIONS(exclude);
+        TOML_OPTIONS(codegen);
+        TOML_OPTIONS(backend);
+        TOML_OPTIONS(include_layout);
+        TOML_OPTIONS(visibility);
+        TOML_OPTIONS(thin_archives);
+        TOML_OPTIONS(config_header);
+        _TOML_OPTIONS(public_data, "public");
     });
 }
\ No newline at end of file
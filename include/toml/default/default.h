@@ -4,6 +4,7 @@
 #include "toml/project.h"
 #include "toml/build.h"
 #include "toml/dependency.h"
+#include "toml/profile.h"
 #include <map>
 
 namespace data
@@ -14,6 +15,8 @@ namespace data
         std::optional<Build> build;
         std::optional<std::map<std::string, Dependency>> dependencies;
         std::optional<Table<Array<std::string>>> features;
+        /// Only the profiles of the root project are used.
+        std::optional<Profiles> profile;
     };
 
     TOML_DESERIALIZE(Default, {
@@ -21,5 +24,6 @@ namespace data
         TOML_OPTIONS(build);
         TOML_OPTIONS(dependencies);
         TOML_OPTIONS(features);
+        TOML_OPTIONS(profile);
     });
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "toml_serde/trait.h"
+
+namespace data
+{
+    /// @brief The code generation settings of the packages a profile applies to.
+    struct ProfileSettings
+    {
+        /// `-O<opt_level>`, from 0 to 3.
+        std::optional<Integer> opt_level;
+        /// `-g` or `-g0`.
+        std::optional<bool> debug_info;
+    };
+
+    TOML_DESERIALIZE_W(ProfileSettings, {
+        TOML_OPTIONS(opt_level);
+        TOML_OPTIONS(debug_info);
+    });
+
+    /// @brief The settings of the dependencies in a build type, `[profile.debug]` or `[profile.release]`.
+    struct Profile
+    {
+        /// All dependencies.
+        std::optional<ProfileSettings> dependencies;
+        /// One dependency by the name of its project, over `dependencies`.
+        std::optional<Table<ProfileSettings>> package;
+    };
+
+    TOML_DESERIALIZE_W(Profile, {
+        TOML_OPTIONS(dependencies);
+        TOML_OPTIONS(package);
+    });
+
+    struct Profiles
+    {
+        std::optional<Profile> debug;
+        std::optional<Profile> release;
+    };
+
+    TOML_DESERIALIZE_W(Profiles, {
+        TOML_OPTIONS(debug);
+        TOML_OPTIONS(release);
+    });
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+/// @brief A snapshot of the compiler probing of CMake, `~/.cup/toolchains/<hash>`.
+/// @note The first configuration of a build directory identifies the compilers and their ABI,
+///       which takes several seconds. The snapshot keeps the `CMake*Compiler.cmake` and
+///       `CMakeSystem.cmake` files written by CMake and the tool paths of the cache, so that
+///       later fresh build directories with the same toolchain are configured without probing.
+///       A snapshot is discarded when a compiler it records has changed on disk.
+class ToolchainCache
+{
+    fs::path dir;
+
+public:
+    /// @brief Get the snapshot of a toolchain.
+    /// @param source_dir The directory of the generated `CMakeLists.txt`.
+    /// @param generator The generator of CMake.
+    /// @param languages The languages enabled by the project.
+    /// @note The snapshot is identified by the version of CMake, the generator, the languages,
+    ///       the compiler of each language with its size and modification time, the environment
+    ///       variables selecting the compilers and their flags, and the lines of the scripts
+    ///       included before `project()` which set variables of CMake. Nothing depends on the
+    ///       path of the project, so fresh clones share the snapshots of earlier checkouts.
+    static ToolchainCache of(const fs::path &source_dir, const std::string &generator,
+                             const std::vector<std::string> &languages);
+
+    /// @brief Get the environment variables which select the compilers and their flags.
+    /// @return The variables as `NAME=value` lines.
+    static std::string environment();
+
+    /// @brief Check whether the snapshots apply to a generator.
+    /// @note Only the Makefile and Ninja generators are supported.
+    static bool supported(const std::string &generator);
+
+    const fs::path &directory() const { return dir; }
+
+    /// @brief Prepare a fresh build directory from the snapshot.
+    /// @param build_dir The build directory, without `CMakeCache.txt`.
+    /// @return The script to pass to CMake with `-C`, or nothing if there is no valid snapshot.
+    std::optional<fs::path> seed(const fs::path &build_dir) const;
+    /// @brief Take a snapshot of a build directory configured without one.
+    /// @param build_dir The configured build directory.
+    void store(const fs::path &build_dir) const;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+/// @brief The compile time report of a build run with `--time-trace`.
+/// @note Clang writes a Chrome trace next to each object with `-ftime-trace`. The traces are
+///       aggregated into the slowest translation units, the headers with the highest
+///       cumulative parse time and the most expensive template instantiations. The times of
+///       headers and instantiations include the nested ones.
+class TimeTrace
+{
+public:
+    /// @brief A row of the report.
+    struct Entry
+    {
+        std::string name;
+        double frontend_ms{0};
+        double backend_ms{0};
+        size_t count{0};
+    };
+
+private:
+    fs::path build_dir;
+    std::vector<fs::path> traces;
+    std::vector<Entry> units;
+    std::vector<Entry> headers;
+    std::vector<Entry> templates;
+
+public:
+    /// @brief Read the traces under a build directory.
+    /// @param build_dir The build directory.
+    /// @param packages (name, directory) of each package, to tell which package a header belongs to.
+    static TimeTrace collect(const fs::path &build_dir,
+                             const std::vector<std::pair<std::string, fs::path>> &packages);
+
+    /// @brief Check whether any trace was found.
+    bool empty() const { return traces.empty(); }
+    /// @brief Print the heaviest entries of each table.
+    /// @param top The number of rows of each table.
+    void print(size_t top = 10) const;
+    /// @brief Merge the traces into one, each translation unit as a process.
+    /// @param file The merged trace, to be opened with `chrome://tracing` or Perfetto.
+    void merge(const fs::path &file) const;
+};
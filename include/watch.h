@@ -0,0 +1,14 @@
+#pragma once
+
+#include "subcmd.h"
+
+/// @brief Rebuild (and rerun) the project whenever its sources change.
+class Watch : public SubCommand
+{
+    cmd::Args args;
+    bool run_mode{false};
+
+public:
+    Watch(const cmd::Args &args);
+    int run() override;
+};
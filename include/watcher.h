@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+namespace fs = std::filesystem;
+
+/// @brief A file system watcher based on inotify.
+class Watcher
+{
+    int fd{-1};
+    /// Watch descriptor -> (directory, watched recursively)
+    std::unordered_map<int, std::pair<fs::path, bool>> dirs;
+    /// Watch descriptors of package directories, where only the manifest is of interest
+    std::unordered_set<int> manifests;
+
+public:
+    struct Event
+    {
+        fs::path path;
+        /// @brief The event changes the file list (create, delete or move) or a manifest.
+        bool structural;
+    };
+
+    Watcher();
+    ~Watcher();
+    Watcher(const Watcher &) = delete;
+    Watcher &operator=(const Watcher &) = delete;
+
+    /// @brief Check whether the watcher is available on this platform.
+    static bool supported();
+    /// @brief Watch a directory.
+    /// @param dir The directory to be watched.
+    /// @param recursive Whether the sub directories are watched too.
+    void watch(const fs::path &dir, bool recursive = true);
+    /// @brief Watch the manifest and the source directories of a cup package.
+    /// @param package The root directory of the package.
+    void watch_package(const fs::path &package);
+    /// @brief Remove all watches.
+    void clear();
+    /// @brief Get the file descriptor of the watcher, which can be polled.
+    int handle() const;
+    /// @brief Read the pending events.
+    /// @param timeout_ms The maximum time to wait for events, -1 to wait forever.
+    /// @return The events, empty on timeout.
+    std::vector<Event> read(int timeout_ms = 0);
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "build.h"
+#include <cstdint>
+
+/// @brief A process compiling preprocessed sources for the builds of the machine, `cup worker`.
+/// @note A worker listens on a Unix socket under `~/.cup/workers/`, which is how builds find it,
+///       so workers of containers sharing that directory serve the builds of each other. Messages
+///       are frames as for plugin hosts. A connection carries any number of requests, which are
+///       compiled concurrently and answered as they finish, each answer naming its request.
+///       The load of the worker is kept up to date in a `.load` file next to the socket, which
+///       the launcher reads to choose a worker without asking each of them.
+class Worker : public SubCommand
+{
+    int jobs;
+    /// The file publishing the load of the worker.
+    int status{-1};
+
+    int serve(int sock);
+
+public:
+    enum class Op : uint8_t
+    {
+        /// Get the number of queued and running jobs, and the number of slots.
+        Status = 1,
+        /// Compile a preprocessed source, answered with the exit code, the diagnostics and the object.
+        Compile = 2,
+    };
+
+    Worker(const cmd::Args &args);
+    int run() override;
+
+    /// @brief Run a compiler command line on a worker, as the compiler launcher of a build.
+    /// @param argc The number of arguments, starting with the compiler.
+    /// @param argv The compiler and its arguments.
+    /// @return The exit code of the compiler.
+    /// @note The source is preprocessed locally and sent to the least loaded worker. Command lines
+    ///       which are not a plain compilation, and jobs which no worker could run, are compiled
+    ///       locally instead. The launcher runs once per compilation, so each of its connections
+    ///       carries a single request: compilations are not batched.
+    static int launch(int argc, char **argv);
+};
@@ -0,0 +1,24 @@
+#include "archive.h"
+#include "cmd/cmd.h"
+#include <stdexcept>
+
+ThinArchive::ThinArchive(const cmd::Args &args) : SubCommand(args)
+{
+    const auto &positions = args.getPositions();
+    if (positions.size() < 4)
+        throw std::runtime_error("Usage: cup ar <ar> <archive> <objects...>");
+    this->ar = positions[1];
+    this->archive = positions[2];
+    for (size_t i = 3; i < positions.size(); i++)
+        this->objects.emplace_back(positions[i]);
+}
+
+int ThinArchive::run()
+{
+    // `q` appends, so that CMake can add the objects of a long command line in several calls.
+    cmd::Command command(this->ar);
+    command.args("qcT", fs::absolute(this->archive).lexically_normal().string());
+    for (const auto &object : this->objects)
+        command.arg(fs::absolute(object).lexically_normal().string());
+    return command.run() == 0 ? 0 : 1;
+}
@@ -5,7 +5,23 @@
 #include "toml/dependency.h"
 #include "toml/default/default.h"
 #include "plugin/built-in/utils.h"
+#include "plugin/built-in/scanner.h"
 #include "cmd/cmake.h"
+#include "cmd/jobserver.h"
+#include "cmd/tools.h"
+#include "fingerprint.h"
+#include "toolchain.h"
+#include "ninja.h"
+#include "trace.h"
+#include "include_tree.h"
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <iterator>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 bool VersionInfo::operator>(const VersionInfo &other) const
 {
@@ -46,18 +62,27 @@ void CMakeOutContent::push(const CMakeOutBlock &block)
     }
 }
 
-void CMakeOutContent::write_to(std::ofstream &ofs)
+void CMakeOutContent::write_to(std::ostream &ofs)
 {
-    for (const auto &[_1, content, _2, version, path] : this->content)
-        ofs << "# Generated by cup" << path << "  " << version << "\n"
-            << content << "\n\n";
+    for (const auto &block : this->content)
+    {
+        ofs << "# Generated by cup" << block.path << "  " << block.version << "\n";
+        // The targets of the script are those which are not there before it.
+        if (block.profile.empty())
+            ofs << "include(" << block.script.generic_string() << ")\n\n";
+        else
+            ofs << "get_property(CUP_TARGETS DIRECTORY PROPERTY BUILDSYSTEM_TARGETS)\n"
+                << "include(" << block.script.generic_string() << ")\n"
+                << "cup_apply_profile(\"${CUP_TARGETS}\" " << join(block.profile, " ") << ")\n\n";
+    }
 }
 
-void CMakeOutContent::write_global_to(std::ofstream &ofs)
+void CMakeOutContent::write_global_to(std::ostream &ofs)
 {
-    for (const auto &[_1, _2, content_global, version, path] : this->content)
-        ofs << "# Generated by cup" << path << "  " << version << "\n"
-            << content_global << "\n\n";
+    for (const auto &block : this->content)
+        if (block.script_global)
+            ofs << "# Generated by cup" << block.path << "  " << block.version << "\n"
+                << "include(" << block.script_global->generic_string() << ")\n\n";
 }
 
 std::ostream &operator<<(std::ostream &os, const VersionInfo &v)
@@ -73,7 +98,27 @@ bool exists_intersetion(const std::vector<std::string> &a, const std::vector<std
     return false;
 }
 
-void Build::generate_cmake(const fs::path &cup, const std::optional<FromParent> &dep_info)
+static std::string read_binary(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+/// @brief Write a file unless it already has the content, so that its timestamp is kept.
+/// @return Whether the file was written.
+static bool write_if_changed(const fs::path &file, const std::string &content)
+{
+    if (fs::exists(file) && fs::file_size(file) == content.size() && read_binary(file) == content)
+        return false;
+    if (!fs::exists(file.parent_path()))
+        fs::create_directories(file.parent_path());
+    std::ofstream ofs(file, std::ios::binary);
+    ofs << content;
+    return true;
+}
+
+size_t Build::resolve(const fs::path &cup, const std::optional<FromParent> &dep_info, std::vector<PackageNode> &nodes,
+                      std::unordered_map<std::string, size_t> &resolved)
 {
     auto config = data::parse_toml_file<data::Default>(cup / "cup.toml");
     auto has_cycle = std::find_if(cycle_check.begin(), cycle_check.end(),
@@ -114,63 +159,302 @@ void Build::generate_cmake(const fs::path &cup, const std::optional<FromParent>
             this->compile_commands = config.build->export_data->compile_commands;
         if (config.build && config.build->languages)
             this->languages = *config.build->languages;
+        if (config.build && config.build->backend)
+        {
+            if (*config.build->backend != "cmake" && *config.build->backend != "ninja")
+                throw std::runtime_error("Unknown backend '" + *config.build->backend + "', expected 'cmake' or 'ninja'.");
+            this->backend = *config.build->backend;
+        }
+        if (config.build && config.build->include_layout)
+        {
+            if (*config.build->include_layout != "separate" && *config.build->include_layout != "unified")
+                throw std::runtime_error("Unknown include_layout '" + *config.build->include_layout +
+                                         "', expected 'separate' or 'unified'.");
+            this->unified_includes = *config.build->include_layout == "unified";
+        }
+        if (config.build && config.build->thin_archives)
+            this->thin_archives = *config.build->thin_archives;
+        if (config.profile)
+            this->profile = this->is_release ? config.profile->release : config.profile->debug;
+        set_lean(cup, lean_codegen(config.build));
     }
     else
     {
         if (config.build && config.build->generator && this->generator != *config.build->generator)
             LOG_WARN("Generator of dependency ", cup, " is different from root. It maybe cause build failure.");
     }
-    auto plugin = PluginLoader(config.project.type);
     std::vector<std::string> this_features;
     if (dep_info)
         this_features = get_features(dep_info->features, config.features);
     else if (config.build && config.build->features)
         this_features = get_features(config.build->features, config.features);
 
+    // A package required several times with the same features is generated once.
+    auto root_dir = dep_info ? dep_info->root_dir : cup;
+    auto key = cup.string() + "\n" + root_dir.string() + "\n" + join(this_features, " ");
+    if (auto iter = resolved.find(key); iter != resolved.end())
+    {
+        this->cycle_check.pop_back();
+        return iter->second;
+    }
+
+    PackageNode node;
+    node.is_dependency = dep_info.has_value();
+    node.type = config.project.type;
+    node.block = CMakeOutBlock{
+        .name = config.project.name,
+        // Named once the package is generated.
+        .script = {},
+        .script_global = std::nullopt,
+        .version = VersionInfo::parse(config.project.version),
+        .path = cup,
+        .profile = dep_info ? this->profile_options(config.project.name) : std::vector<std::string>{},
+    };
+    node.key = key;
     std::set<std::string> vaild_dependencies;
-    std::vector<std::string> expand_features;
     for (const auto &[name, info] : config.dependencies.value_or(std::map<std::string, data::Dependency>{}))
     {
         if (info.optional && !exists_intersetion(this_features, *info.optional))
             continue;
         auto [path, version] = get_path(info, true, cup);
-        std::string dep_name;
-        {
-            auto dep_config = data::parse_toml_file<data::Default>(path / "cup.toml");
-            dep_name = dep_config.project.name;
-        }
-        this->generate_cmake(
+        auto index = this->resolve(
             path,
             FromParent{
                 .features = info.features.value_or(std::vector<std::string>{}),
-                .root_dir = dep_info ? dep_info->root_dir : cup,
-            });
+                .root_dir = root_dir,
+            },
+            nodes, resolved);
         vaild_dependencies.insert(name);
+        node.dependencies.emplace_back(name, index);
     }
-
-    CMakeContext ctx{
+    node.ctx = CMakeContext{
         .name = config.project.name,
         .cmake_version = this->cmake_version,
         .current_dir = cup,
-        .root_dir = dep_info ? dep_info->root_dir : cup,
+        .root_dir = root_dir,
         .features = this_features,
         .dependencies = vaild_dependencies,
     };
-    auto out_content = plugin->gen_cmake(ctx, dep_info.has_value());
-    if (out_content.is_error())
-        throw std::runtime_error(out_content.error());
-    auto out_g_content = plugin->gen_cmake_global(ctx, dep_info.has_value());
-    if (out_g_content.is_error())
-        throw std::runtime_error(out_g_content.error());
-    CMakeOutBlock block{
-        .name = config.project.name,
-        .content = out_content.ok(),
-        .content_global = out_g_content.ok(),
-        .version = VersionInfo::parse(config.project.version),
-        .path = cup,
-    };
     this->cycle_check.pop_back();
-    this->output.push(block);
+    nodes.push_back(std::move(node));
+    resolved[key] = nodes.size() - 1;
+    return nodes.size() - 1;
+}
+
+std::vector<std::string> Build::profile_options(const std::string &name) const
+{
+    if (!this->profile)
+        return {};
+    auto settings = this->profile->dependencies.value_or(data::ProfileSettings{});
+    if (this->profile->package && this->profile->package->contains(name))
+    {
+        const auto &own = this->profile->package->at(name);
+        if (own.opt_level)
+            settings.opt_level = own.opt_level;
+        if (own.debug_info)
+            settings.debug_info = own.debug_info;
+    }
+    std::vector<std::string> options;
+    if (settings.opt_level)
+    {
+        if (*settings.opt_level < 0 || *settings.opt_level > 3)
+            throw std::runtime_error("Invalid opt_level " + std::to_string(*settings.opt_level) + " in the profile of " +
+                                     name + ", expected 0 to 3.");
+        options.push_back("-O" + std::to_string(*settings.opt_level));
+    }
+    if (settings.debug_info)
+        options.push_back(*settings.debug_info ? "-g" : "-g0");
+    return options;
+}
+
+void Build::generate_package(PackageNode &node, const std::vector<PackageNode> &nodes)
+{
+    auto &block = node.block;
+    std::vector<std::string> dep_digests;
+    for (const auto &[name, index] : node.dependencies)
+        dep_digests.push_back(name + " " + nodes[index].digest);
+
+    // The block is reused while none of the inputs in the fingerprint has changed.
+    // Only plugins which declare their inputs can be cached.
+    auto plugin = PluginLoader(node.type, this->isolate);
+    auto build_dir = Resource::build(this->root);
+    // A package required with other features is another node, generated concurrently into other files.
+    auto stem = block.name + "-" + Fingerprint::hash(node.key).substr(0, 8);
+    auto cache_file = build_dir / ".cup" / (stem + ".block");
+    auto script_global = fs::path(".cup") / (stem + ".global.cmake");
+    block.script = fs::path(".cup") / (stem + ".cmake");
+    std::string uncacheable = "plugin '" + node.type + "' does not declare its inputs";
+    std::optional<Fingerprint> fingerprint;
+    std::optional<Fingerprint> cached;
+    if (auto cacheable = plugin.cacheable())
+    {
+        auto inputs = [&]()
+        {
+            auto lock = plugin.acquire();
+            return cacheable->declare_inputs(node.ctx, node.is_dependency);
+        }();
+        if (inputs.is_error())
+            uncacheable = inputs.error();
+        else
+        {
+            fingerprint = Fingerprint::of(node.ctx, node.is_dependency, node.type, inputs.ok(), dep_digests);
+            cached = Fingerprint::load(cache_file);
+        }
+    }
+    if (cached && cached->digest() == fingerprint->digest() && fs::exists(build_dir / block.script))
+    {
+        node.explanation = "Reuse " + block.name + ": up to date";
+        if (fs::exists(build_dir / script_global))
+            block.script_global = script_global;
+        node.digest = fingerprint->digest();
+        return;
+    }
+
+    std::vector<std::string> reasons;
+    if (!fingerprint)
+        reasons.push_back(uncacheable);
+    else if (!cached)
+        reasons.push_back("no previous generation");
+    else if (cached->digest() == fingerprint->digest())
+        reasons.push_back("generated script missing");
+    else
+        reasons = fingerprint->diff(*cached);
+    node.explanation = "Regenerate " + block.name + ": " + join(reasons, "; ");
+    std::string content, content_global;
+    {
+        auto lock = plugin.acquire();
+        auto out_content = plugin->gen_cmake(node.ctx, node.is_dependency);
+        if (out_content.is_error())
+            throw std::runtime_error(out_content.error());
+        auto out_g_content = plugin->gen_cmake_global(node.ctx, node.is_dependency);
+        if (out_g_content.is_error())
+            throw std::runtime_error(out_g_content.error());
+        content = out_content.ok();
+        content_global = out_g_content.ok();
+    }
+    // Scripts go to disk as soon as they are generated, so the memory held during
+    // the generation does not grow with the number of packages.
+    node.changed = write_if_changed(build_dir / block.script, content);
+    if (!content_global.empty())
+    {
+        block.script_global = script_global;
+        node.changed = write_if_changed(build_dir / script_global, content_global) || node.changed;
+    }
+    else if (fs::remove(build_dir / script_global))
+        node.changed = true;
+    if (fingerprint)
+        fingerprint->save(cache_file);
+    node.digest = fingerprint ? fingerprint->digest() : Fingerprint::hash(content + "\n" + content_global);
+}
+
+void Build::generate_cmake(std::vector<PackageNode> &nodes)
+{
+    // A package is ready once all its dependencies are generated, since their digests
+    // are part of its fingerprint.
+    std::vector<size_t> pending(nodes.size());
+    std::vector<std::vector<size_t>> dependents(nodes.size());
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        std::set<size_t> deps;
+        for (const auto &[_, index] : nodes[i].dependencies)
+            deps.insert(index);
+        pending[i] = deps.size();
+        for (auto dep : deps)
+            dependents[dep].push_back(i);
+        if (deps.empty())
+            ready.push_back(i);
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t remaining = nodes.size();
+    std::exception_ptr error;
+    auto worker = [&]()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            cv.wait(lock, [&]()
+                    { return !ready.empty() || remaining == 0 || error; });
+            if (ready.empty())
+                return;
+            auto index = ready.front();
+            ready.pop_front();
+            lock.unlock();
+            std::exception_ptr failure;
+            try
+            {
+                this->generate_package(nodes[index], nodes);
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+            }
+            lock.lock();
+            remaining--;
+            if (failure)
+            {
+                error = error ? error : failure;
+                ready.clear();
+            }
+            else if (!error)
+            {
+                for (auto dependent : dependents[index])
+                    if (--pending[dependent] == 0)
+                        ready.push_back(dependent);
+            }
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    auto count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), nodes.size());
+    for (size_t i = 1; i < count; i++)
+        workers.emplace_back(worker);
+    worker();
+    for (auto &thread : workers)
+        thread.join();
+    if (error)
+        std::rethrow_exception(error);
+
+    // Blocks are collected in the resolved order, whichever finished first.
+    for (auto &node : nodes)
+    {
+        if (this->explain)
+            LOG_INFO(node.explanation);
+        if (node.changed)
+            this->changed.push_back(node.block.name);
+        this->packages.push_back(node.block.path);
+        this->package_names.push_back(node.block.name);
+        this->output.push(node.block);
+    }
+}
+
+bool Build::generate_ninja(const std::vector<PackageNode> &nodes)
+{
+    std::optional<std::string> reason;
+    if (!cmd::ToolRegistry::instance().find("ninja"))
+        reason = "ninja is not installed";
+    NinjaBackend backend(this->root, this->is_release, this->launcher(), this->thin_archives && !this->full_archives);
+    if (!reason)
+        reason = backend.generate(nodes);
+    if (reason)
+    {
+        LOG_WARN("The ninja backend is not used: ", *reason, ". Fall back to CMake.");
+        return false;
+    }
+    this->changed = backend.changed();
+    if (this->explain)
+        LOG_INFO(this->changed.empty() ? "The ninja files are up to date"
+                                       : "Rewrite the ninja files of " + join(this->changed, ", "));
+    for (const auto &node : nodes)
+    {
+        this->packages.push_back(node.block.path);
+        this->package_names.push_back(node.block.name);
+    }
+    if (this->time_trace)
+        LOG_WARN("The ninja backend does not support --time-trace.");
+    return true;
 }
 
 Build::Build(const cmd::Args &args) : SubCommand(args)
@@ -185,69 +469,315 @@ Build::Build(const cmd::Args &args) : SubCommand(args)
     this->root = this->root.lexically_normal();
     if (args.getPositions().size() > 1)
         this->command = args.getPositions()[1];
+    this->explain = args.has_flag("explain");
+    this->timings = args.has_flag("timings");
+    this->isolate = args.has_flag("isolate");
+    this->distribute = args.has_flag("distribute");
+    this->time_trace = args.has_flag("time-trace");
+    this->full_archives = args.has_flag("full-archives");
 }
 
-int Build::run()
+std::string Build::launcher() const
 {
-    this->generate_cmake(this->root);
-
-    auto build_dir = Resource::build(this->root);
-    if (!fs::exists(build_dir))
-        fs::create_directories(build_dir);
-    {
-        std::ofstream ofs(build_dir / "CMakeLists.txt");
-        ofs << "cmake_minimum_required(VERSION " << this->cmake_version.first << "." << this->cmake_version.second << ")\n";
-        if (this->compile_commands)
-            ofs << "set(CMAKE_EXPORT_COMPILE_COMMANDS ON)\n\n";
-        this->output.write_global_to(ofs);
-        ofs << "project(" << this->name << ")\n\n";
-        if (this->is_release)
-            ofs <<
-#include "template/release.cmake"
-                << std::endl
-                << std::endl;
-        else
-            ofs <<
-#include "template/debug.cmake"
-                << std::endl
-                << std::endl;
-        if (!this->languages.empty())
-            ofs << "enable_language(" << join(this->languages, " ") << ")\n\n";
-        this->output.write_to(ofs);
+    if (!this->distribute)
+        return "";
+    auto exe = Resource::executable();
+    if (exe.empty())
+    {
+        LOG_WARN("Cannot identify the cup executable, compile locally.");
+        return "";
     }
+    return "\"" + exe.generic_string() + "\" launch";
+}
+
+std::string Build::generation_key() const
+{
+    return this->root.string() + (this->is_release ? "#release" : "#debug") + (this->distribute ? "#distribute" : "") +
+           (this->time_trace ? "#time-trace" : "") + (this->full_archives ? "#full-archives" : "");
+}
+
+const std::vector<fs::path> &Build::get_packages() const
+{
+    return this->packages;
+}
 
+void Build::reuse_generation(const Build &other)
+{
+    this->generator = other.generator;
+    this->jobs = other.jobs;
+    this->cmake_version = other.cmake_version;
+    this->name = other.name;
+    this->packages = other.packages;
+    this->package_names = other.package_names;
+    this->compile_commands = other.compile_commands;
+    this->languages = other.languages;
+    this->backend = other.backend;
+    this->unified_includes = other.unified_includes;
+    this->thin_archives = other.thin_archives;
+    this->ninja = other.ninja;
+    this->generated = true;
+}
+
+void Build::configure()
+{
     cmd::CMake cmake;
     cmake.source(Resource::build(this->root));
     cmake.build_dir(Resource::cmake(this->root));
     cmake.generator(this->generator);
 
+    // A fresh build directory takes the compiler probing of an earlier one with the same toolchain.
+    std::optional<ToolchainCache> toolchain;
+    std::optional<fs::path> seed;
+    if (!fs::exists(Resource::cmake(this->root) / "CMakeCache.txt") && ToolchainCache::supported(this->generator))
+    {
+        toolchain = ToolchainCache::of(Resource::build(this->root), this->generator, this->languages);
+        seed = toolchain->seed(Resource::cmake(this->root));
+        if (seed)
+        {
+            LOG_INFO("Use the toolchain snapshot ", toolchain->directory().string());
+            cmake.initial_cache(*seed);
+        }
+    }
+
     auto ret = system(cmake.as_command().c_str());
     if (ret != 0)
         throw std::runtime_error("Failed to generate build files.");
+    if (toolchain && !seed)
+    {
+        try
+        {
+            toolchain->store(Resource::cmake(this->root));
+        }
+        catch (const std::exception &e)
+        {
+            LOG_WARN("Failed to save a snapshot of the toolchain: ", e.what());
+        }
+    }
+}
 
-    if (this->compile_commands)
+void Build::export_compile_commands()
+{
+    if (!this->compile_commands)
+        return;
+    auto compile_commands_path = this->compile_commands.value();
+    if (!compile_commands_path.empty() && fs::exists(Resource::cmake(this->root) / "compile_commands.json"))
+    {
+        if (!fs::exists(compile_commands_path))
+            fs::create_directories(compile_commands_path);
+        fs::copy_file(Resource::cmake(this->root) / "compile_commands.json",
+                      compile_commands_path / "compile_commands.json", fs::copy_options::overwrite_existing);
+        LOG_INFO("Copy compile_commands.json to ", compile_commands_path.lexically_normal().string());
+    }
+    if (!fs::exists(Resource::cmake(this->root) / "compile_commands.json"))
+        LOG_WARN("This generator may not support generating compile_commands.json files.");
+}
+
+void Build::report_time_trace()
+{
+    std::vector<std::pair<std::string, fs::path>> packages;
+    for (size_t i = 0; i < this->packages.size(); i++)
+        packages.emplace_back(this->package_names[i], this->packages[i]);
+    auto trace = TimeTrace::collect(Resource::cmake(this->root), packages);
+    if (trace.empty())
+    {
+        LOG_WARN("No time trace was found. --time-trace needs Clang 9 or later.");
+        return;
+    }
+    trace.print();
+    auto file = Resource::build(this->root) / "time-trace.json";
+    trace.merge(file);
+    LOG_INFO("Merged time trace: ", file.string());
+}
+
+void Build::print_timings(const std::vector<std::pair<std::string, double>> &phases)
+{
+    auto print = [](const std::string &name, double ms)
+    {
+        std::ostringstream oss;
+        oss << "    " << std::left << std::setw(24) << name << std::right << std::setw(10)
+            << std::fixed << std::setprecision(1) << ms << " ms";
+        LOG_INFO(oss.str());
+    };
+    LOG_INFO("Timings:");
+    for (const auto &[name, ms] : phases)
+        print(name, ms);
+    for (const auto &[type, ms] : PluginRegistry::instance().load_times())
+        print("load plugin " + type, ms);
+}
+
+int Build::run()
+{
+    using clock = std::chrono::steady_clock;
+    std::vector<std::pair<std::string, double>> phases;
+    auto record = [&phases](const std::string &name, clock::time_point start)
+    { phases.emplace_back(name, std::chrono::duration<double, std::milli>(clock::now() - start).count()); };
+
+    auto build_dir = Resource::build(this->root);
+    auto cache = Resource::cmake(this->root) / "CMakeCache.txt";
+    std::vector<std::string> reasons;
+    if (!fs::exists(cache))
+        reasons.push_back("no CMake cache");
+    if (!this->generated)
     {
-        auto compile_commands_path = this->compile_commands.value();
-        if (!compile_commands_path.empty() && fs::exists(Resource::cmake(this->root) / "compile_commands.json"))
+        auto start = clock::now();
+        // Directory listings of the previous generation spare walking unchanged source trees.
+        auto &scanner = SourceScanner::instance();
+        scanner.load(build_dir / "scan.cache");
+        // Resolving reads manifests and may download dependencies, so it stays sequential.
+        std::vector<PackageNode> nodes;
+        std::unordered_map<std::string, size_t> resolved;
+        this->resolve(this->root, std::nullopt, nodes, resolved);
+        // The plugins look the tree up to tell where the public headers of a library are.
+        std::vector<std::pair<fs::path, fs::path>> public_dirs;
+        if (this->unified_includes)
+            for (const auto &node : nodes)
+            {
+                if (node.type == "static" || node.type == "shared")
+                    public_dirs.emplace_back(node.ctx.current_dir, node.ctx.current_dir / "export");
+                else if (node.type == "interface")
+                    public_dirs.emplace_back(node.ctx.current_dir, node.ctx.current_dir / "include");
+            }
+        auto merged = IncludeTree::sync(this->root, public_dirs);
+        if (this->explain && this->unified_includes)
+            LOG_INFO("Merge the public headers of ", merged.size(), " of ", public_dirs.size(),
+                     " libraries into ", IncludeTree::directory(this->root));
+        this->ninja = this->backend == "ninja" && this->generate_ninja(nodes);
+        if (!this->ninja)
+            this->generate_cmake(nodes);
+        scanner.save(build_dir / "scan.cache");
+        if (!this->ninja)
         {
-            if (!fs::exists(compile_commands_path))
-                fs::create_directories(compile_commands_path);
-            fs::copy_file(Resource::cmake(this->root) / "compile_commands.json",
-                          compile_commands_path / "compile_commands.json", fs::copy_options::overwrite_existing);
-            LOG_INFO("Copy compile_commands.json to ", compile_commands_path.lexically_normal().string());
+            std::ostringstream oss;
+            oss << "cmake_minimum_required(VERSION " << this->cmake_version.first << "." << this->cmake_version.second << ")\n";
+            if (this->compile_commands)
+                oss << "set(CMAKE_EXPORT_COMPILE_COMMANDS ON)\n\n";
+            if (auto launcher = this->launcher(); !launcher.empty())
+                oss << "set(CMAKE_C_COMPILER_LAUNCHER " << launcher << ")\n"
+                    << "set(CMAKE_CXX_COMPILER_LAUNCHER " << launcher << ")\n\n";
+            // Run after linking a shared library, see `cup ifs`.
+            auto exe = Resource::executable();
+            if (!exe.empty())
+                oss << "set(CUP_IFS_COMMAND \"" << exe.generic_string() << "\" ifs)\n\n";
+            this->output.write_global_to(oss);
+            oss << "project(" << this->name << ")\n\n";
+            // Once the stubs are written, no target of the build depends on the files of the shared libraries
+            // it links, only on their stubs. The format is only known after `project()`.
+            if (!exe.empty())
+                oss << "if(CMAKE_EXECUTABLE_FORMAT STREQUAL \"ELF\" AND CMAKE_GENERATOR MATCHES \"Makefiles|Ninja\")\n"
+                    << "    set(CMAKE_LINK_DEPENDS_NO_SHARED ON)\n"
+                    << "endif()\n\n";
+            if (this->is_release)
+                oss <<
+#include "template/release.cmake"
+                    << std::endl
+                    << std::endl;
+            else
+                oss <<
+#include "template/debug.cmake"
+                    << std::endl
+                    << std::endl;
+            // Only Clang writes a trace per object, GCC would only print a report to the build log.
+            if (this->time_trace)
+                oss << "add_compile_options(\"$<$<COMPILE_LANG_AND_ID:C,Clang,AppleClang>:-ftime-trace>\"\n"
+                    << "                    \"$<$<COMPILE_LANG_AND_ID:CXX,Clang,AppleClang>:-ftime-trace>\")\n\n";
+            if (!this->languages.empty())
+                oss << "enable_language(" << join(this->languages, " ") << ")\n\n";
+            // The static libraries are written by `cup ar`, which gives ar the objects by absolute path.
+            if (auto exe = Resource::executable(); this->thin_archives && !this->full_archives && !exe.empty())
+                oss << "set(CUP_AR_COMMAND \"\\\"" << exe.generic_string() << "\\\" ar\")\n"
+                    <<
+#include "template/thin_archives.cmake"
+                    << std::endl
+                    << std::endl;
+            if (this->profile)
+                oss <<
+#include "template/profile.cmake"
+                    << std::endl
+                    << std::endl;
+            this->output.write_to(oss);
+
+            // Unchanged scripts keep their timestamps, so nothing is reconfigured.
+            if (write_if_changed(build_dir / "CMakeLists.txt", oss.str()) || !this->changed.empty())
+                reasons.push_back(this->changed.empty()
+                                      ? "CMakeLists.txt changed"
+                                      : "scripts changed by " + join(this->changed, ", "));
+            auto cached_generator = read_binary(cache);
+            auto pos = cached_generator.find("CMAKE_GENERATOR:INTERNAL=");
+            if (pos != std::string::npos)
+            {
+                cached_generator = cached_generator.substr(pos + 25);
+                cached_generator = cached_generator.substr(0, cached_generator.find_first_of("\r\n"));
+                if (cached_generator != this->generator)
+                    reasons.push_back("generator changed: " + cached_generator + " -> " + this->generator);
+            }
         }
-        if (!fs::exists(Resource::cmake(this->root) / "compile_commands.json"))
-            LOG_WARN("This generator may not support generating compile_commands.json files.");
+        record("generate", start);
     }
 
-    cmd::CMake cmake_build;
-    cmake_build.build(Resource::cmake(this->root));
-    cmake_build.config(this->is_release);
-    if (this->target)
-        cmake_build.target(*this->target);
-    cmake_build.jobs(static_cast<int>(this->jobs));
+    // Otherwise the build tool reconfigures by itself if anything else requires it.
+    if (this->ninja)
+    {
+        if (this->explain)
+            LOG_INFO("Skip reconfigure: the ninja backend needs no CMake");
+    }
+    else if (!reasons.empty())
+    {
+        if (this->explain)
+            LOG_INFO("Reconfigure: ", join(reasons, "; "));
+        auto start = clock::now();
+        this->configure();
+        record("configure", start);
+    }
+    else if (this->explain)
+        LOG_INFO("Skip reconfigure: the build files are up to date");
+    if (!this->generated && this->ninja && this->compile_commands)
+    {
+        cmd::Command compdb("ninja");
+        compdb.args("-C", NinjaBackend::directory(this->root).string(), "-t", "compdb", "cc", "cxx");
+        compdb.set_stdout(Resource::cmake(this->root) / "compile_commands.json");
+        if (compdb.run() != 0)
+            LOG_WARN("Failed to generate compile_commands.json with ninja.");
+    }
+    if (!this->generated)
+        this->export_compile_commands();
 
-    ret = system(cmake_build.as_command().c_str());
+    // With a jobserver, the build tool draws its jobs from the shared pool
+    // instead of starting its own set of workers.
+    auto generator = this->ninja ? std::string("Ninja") : this->generator;
+    std::optional<cmd::JobServer> jobserver;
+    if (cmd::JobServer::supported(generator))
+        jobserver.emplace(Resource::build(this->root), static_cast<int>(this->jobs), generator.starts_with("Ninja"));
+    if (jobserver && jobserver->is_client())
+        LOG_INFO("Share the job slots of the parent jobserver.");
+
+    auto start = clock::now();
+    int ret;
+    if (this->ninja)
+    {
+        cmd::Command ninja("ninja");
+        ninja.args("-C", NinjaBackend::directory(this->root).string());
+        if (!jobserver)
+            ninja.args("-j", std::to_string(this->jobs));
+        if (this->target)
+            ninja.arg(*this->target);
+        ret = ninja.run();
+    }
+    else
+    {
+        cmd::CMake cmake_build;
+        cmake_build.build(Resource::cmake(this->root));
+        cmake_build.config(this->is_release);
+        if (this->target)
+            cmake_build.target(*this->target);
+        if (!jobserver)
+            cmake_build.jobs(static_cast<int>(this->jobs));
+        ret = system(cmake_build.as_command().c_str());
+    }
+    record("build", start);
+    if (this->time_trace && !this->ninja)
+        this->report_time_trace();
+    if (this->timings)
+        this->print_timings(phases);
     if (ret != 0)
         throw std::runtime_error("Failed to build project.");
 
@@ -1,24 +1,17 @@
 #include "cmd/cmake.h"
+#include "cmd/tools.h"
 #include "utils/utils.h"
 #include "log.h"
 
-static bool has_cmake()
+const std::string &cmd::CMake::version()
 {
-    using namespace cmd;
-    Command cmk("cmake");
-    cmk.arg("--version");
-    auto result = cmk.exec();
-    LOG_DEBUG("cmake check:", result.exit_code());
-    return result.exit_code() == 0;
+    static auto version = ToolRegistry::instance().require("cmake").version;
+    return version;
 }
 
 cmd::CMake::CMake()
 {
-    static bool has_cmake_ = has_cmake();
-    if (!has_cmake_)
-    {
-        throw std::runtime_error("cmake is not installed.");
-    }
+    version();
     this->commands.push_back("cmake");
 }
 
@@ -43,6 +36,13 @@ cmd::CMake &cmd::CMake::generator(const std::string &generator)
     return *this;
 }
 
+cmd::CMake &cmd::CMake::initial_cache(const fs::path &script)
+{
+    this->commands.push_back("-C");
+    this->commands.push_back(script.string());
+    return *this;
+}
+
 cmd::CMake &cmd::CMake::target(const std::string &target)
 {
     this->commands.push_back("--target");
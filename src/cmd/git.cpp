@@ -1,23 +1,14 @@
 #include "cmd/git.h"
+#include "cmd/tools.h"
 #include "utils/utils.h"
 #include "res.h"
 #include <iostream>
 
-bool has_git()
-{
-    using namespace cmd;
-    Command cmd("git");
-    cmd.arg("--version");
-    auto result = cmd.exec();
-    return result.exit_code() == 0;
-}
-
 cmd::Git::Git()
 {
-    static bool has_git_ = has_git();
-    if (!has_git_)
-        throw std::runtime_error("git is not installed.");
+    ToolRegistry::instance().require("git");
 }
+
 std::vector<std::string> cmd::Git::get_tags(const std::string &url)
 {
     using namespace cmd;
@@ -0,0 +1,196 @@
+#include "cmd/jobserver.h"
+#include "cmd/tools.h"
+#include "utils/utils.h"
+#include "log.h"
+#include <stdexcept>
+#include <cstdlib>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+/// @brief Get the value of `--jobserver-auth` (or the legacy `--jobserver-fds`) in `MAKEFLAGS`.
+static std::string jobserver_auth()
+{
+    auto makeflags = std::getenv("MAKEFLAGS");
+    if (makeflags == nullptr)
+        return "";
+    std::string auth;
+    for (const auto &word : split(makeflags, " "))
+    {
+        // The last one wins, as GNU make does.
+        for (const std::string prefix : {"--jobserver-auth=", "--jobserver-fds="})
+            if (word.starts_with(prefix))
+                auth = word.substr(prefix.size());
+    }
+    return auth;
+}
+
+/// @brief Get the job limit of the outer make, the `-j<N>` word in `MAKEFLAGS`.
+/// @return The limit, or `0` if `MAKEFLAGS` does not carry one.
+static int outer_jobs()
+{
+    auto makeflags = std::getenv("MAKEFLAGS");
+    if (makeflags == nullptr)
+        return 0;
+    int jobs = 0;
+    for (const auto &word : split(makeflags, " "))
+    {
+        if (!word.starts_with("-j") || word.size() == 2)
+            continue;
+        try
+        {
+            jobs = std::stoi(word.substr(2));
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+    return jobs;
+}
+
+std::optional<std::pair<int, int>> cmd::JobServer::descriptors()
+{
+#ifdef _WIN32
+    return std::nullopt;
+#else
+    auto auth = jobserver_auth();
+    if (auth.empty() || auth.starts_with("fifo:"))
+        return std::nullopt;
+    auto fds = split(auth, ",");
+    if (fds.size() != 2)
+        return std::nullopt;
+    try
+    {
+        auto rfd = std::stoi(fds[0]), wfd = std::stoi(fds[1]);
+        // The outer make closes the pipe for commands not marked as recursive.
+        if (rfd >= 0 && wfd >= 0 && fcntl(rfd, F_GETFD) != -1 && fcntl(wfd, F_GETFD) != -1)
+            return std::make_pair(rfd, wfd);
+    }
+    catch (const std::exception &)
+    {
+    }
+    return std::nullopt;
+#endif
+}
+
+bool cmd::JobServer::inherited()
+{
+#ifdef _WIN32
+    return false;
+#else
+    auto auth = jobserver_auth();
+    if (auth.starts_with("fifo:"))
+    {
+        struct stat st;
+        return stat(auth.substr(5).c_str(), &st) == 0 && S_ISFIFO(st.st_mode);
+    }
+    return descriptors().has_value();
+#endif
+}
+
+bool cmd::JobServer::supported(const std::string &generator)
+{
+#ifdef _WIN32
+    return false;
+#else
+    if (generator.find("Makefiles") != std::string::npos)
+        return true;
+    if (generator.starts_with("Ninja"))
+    {
+        // Ninja only understands the fifo form on POSIX.
+        auto ninja = ToolRegistry::instance().find("ninja");
+        return ninja && ninja->has("jobserver");
+    }
+    return false;
+#endif
+}
+
+cmd::JobServer::JobServer(const fs::path &dir, int jobs, bool fifo_auth)
+{
+#ifdef _WIN32
+    throw std::runtime_error("Jobserver is not supported on this platform.");
+#else
+    auto inherited = JobServer::inherited();
+    if (inherited && (!fifo_auth || jobserver_auth().starts_with("fifo:")))
+    {
+        this->client = true;
+        LOG_DEBUG("Join jobserver: ", jobserver_auth());
+        return;
+    }
+    if (inherited)
+    {
+        // A tool which only reads the fifo form cannot use the descriptors of the outer
+        // make, so it is given a fifo of its own, as large as the limit of the outer make.
+        if (auto outer = outer_jobs(); outer > 0)
+            jobs = outer;
+        LOG_DEBUG("Serve a fifo jobserver in place of: ", jobserver_auth());
+    }
+    else if (!jobserver_auth().empty())
+        LOG_WARN("The jobserver in MAKEFLAGS is not accessible. Mark the rule invoking cup with '+' to share it.");
+
+    if (!fs::exists(dir))
+        fs::create_directories(dir);
+    this->fifo = dir / "jobserver.fifo";
+    if (fs::exists(this->fifo))
+        fs::remove(this->fifo);
+    if (mkfifo(this->fifo.c_str(), 0600) != 0)
+        throw std::runtime_error("Failed to create jobserver fifo: " + this->fifo.string());
+    // Opened for both reading and writing so that the fifo never reports EOF
+    // while cup is alive. Both descriptors are inherited by child processes
+    // for the tools that only understand the `R,W` form.
+    this->fd = open(this->fifo.c_str(), O_RDWR);
+    if (this->fd != -1)
+        this->wfd = open(this->fifo.c_str(), O_WRONLY);
+    if (this->fd == -1 || this->wfd == -1)
+    {
+        if (this->fd != -1)
+            close(this->fd);
+        fs::remove(this->fifo);
+        throw std::runtime_error("Failed to open jobserver fifo: " + this->fifo.string());
+    }
+    // Every child owns one implicit job slot, so the pool holds the rest.
+    const std::string tokens(std::max(jobs - 1, 0), '+');
+    if (!tokens.empty() && write(this->fd, tokens.data(), tokens.size()) != (ssize_t)tokens.size())
+    {
+        close(this->fd);
+        close(this->wfd);
+        fs::remove(this->fifo);
+        throw std::runtime_error("Failed to fill jobserver fifo: " + this->fifo.string());
+    }
+
+    auto makeflags = std::getenv("MAKEFLAGS");
+    this->had_makeflags = makeflags != nullptr;
+    if (this->had_makeflags)
+        this->old_makeflags = makeflags;
+    auto auth = fifo_auth ? "fifo:" + this->fifo.string()
+                          : std::to_string(this->fd) + "," + std::to_string(this->wfd);
+    auto value = this->old_makeflags + " -j" + std::to_string(jobs) + " --jobserver-auth=" + auth;
+    setenv("MAKEFLAGS", value.c_str(), 1);
+    LOG_DEBUG("Serve jobserver: ", value);
+#endif
+}
+
+cmd::JobServer::~JobServer()
+{
+#ifndef _WIN32
+    if (this->client)
+        return;
+    if (this->had_makeflags)
+        setenv("MAKEFLAGS", this->old_makeflags.c_str(), 1);
+    else
+        unsetenv("MAKEFLAGS");
+    if (this->fd != -1)
+        close(this->fd);
+    if (this->wfd != -1)
+        close(this->wfd);
+    std::error_code ec;
+    fs::remove(this->fifo, ec);
+#endif
+}
+
+bool cmd::JobServer::is_client() const
+{
+    return this->client;
+}
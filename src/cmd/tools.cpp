@@ -0,0 +1,195 @@
+#include "cmd/tools.h"
+#include "utils/utils.h"
+#include "res.h"
+#include "log.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <stdexcept>
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <unistd.h>
+#endif
+
+/// The capabilities of the tools and the versions introducing them.
+static const struct
+{
+    const char *tool;
+    const char *capability;
+    int major;
+    int minor;
+} CAPABILITIES[] = {
+    // `FILE_SET CXX_MODULES` without experimental flags
+    {"cmake", "cxx-modules", 3, 28},
+    // Reading the jobserver from `MAKEFLAGS`
+    {"ninja", "jobserver", 1, 13},
+};
+
+/// @brief Get the first word looking like a version, such as `3.28.1` in `cmake version 3.28.1`.
+static std::string parse_version(const std::string &output)
+{
+    std::istringstream iss(output);
+    std::string word;
+    while (iss >> word)
+        if (std::isdigit(static_cast<unsigned char>(word[0])) && word.find('.') != std::string::npos)
+            return word;
+    return "";
+}
+
+/// @brief Identify a version of an executable by its modification time and size.
+static std::string stamp(const fs::path &path)
+{
+    std::error_code ec;
+    auto time = fs::last_write_time(path, ec);
+    auto size = fs::file_size(path, ec);
+    return ec ? "" : std::to_string(time.time_since_epoch().count()) + "-" + std::to_string(size);
+}
+
+/// @brief Run `<path> --version`.
+/// @return The version, or nothing if the tool fails.
+static std::optional<std::string> query_version(const fs::path &path)
+{
+    auto command = "\"" + path.string() + "\" --version 2>&1";
+    auto pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr)
+        return std::nullopt;
+    std::string output;
+    char buffer[256];
+    while (auto count = std::fread(buffer, 1, sizeof(buffer), pipe))
+        output.append(buffer, count);
+    if (pclose(pipe) != 0)
+        return std::nullopt;
+    return parse_version(output);
+}
+
+bool cmd::Tool::at_least(int major, int minor) const
+{
+    auto parts = split(this->version, ".");
+    try
+    {
+        auto x = parts.size() > 0 ? std::stoi(parts[0]) : 0;
+        auto y = parts.size() > 1 ? std::stoi(parts[1]) : 0;
+        return x > major || (x == major && y >= minor);
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+bool cmd::Tool::has(const std::string &capability) const
+{
+    for (const auto &item : CAPABILITIES)
+        if (this->name == item.tool && capability == item.capability)
+            return this->at_least(item.major, item.minor);
+    return false;
+}
+
+cmd::ToolRegistry &cmd::ToolRegistry::instance()
+{
+    static ToolRegistry registry;
+    return registry;
+}
+
+std::optional<fs::path> cmd::ToolRegistry::which(const std::string &name)
+{
+    auto path = std::getenv("PATH");
+    if (path == nullptr)
+        return std::nullopt;
+#ifdef _WIN32
+    auto pathext = std::getenv("PATHEXT");
+    auto extensions = split(pathext ? pathext : ".COM;.EXE;.BAT;.CMD", ";");
+    const std::string separator = ";";
+#else
+    const std::vector<std::string> extensions{""};
+    const std::string separator = ":";
+#endif
+    for (const auto &dir : split(path, separator))
+    {
+        if (dir.empty())
+            continue;
+        for (const auto &extension : extensions)
+        {
+            auto file = fs::path(dir) / (name + extension);
+            std::error_code ec;
+            if (!fs::is_regular_file(file, ec))
+                continue;
+#ifndef _WIN32
+            if (access(file.c_str(), X_OK) != 0)
+                continue;
+#endif
+            return file;
+        }
+    }
+    return std::nullopt;
+}
+
+void cmd::ToolRegistry::load()
+{
+    this->loaded = true;
+    std::ifstream ifs(Resource::cache() / "tools.cache");
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        // <name>\t<path>\t<mtime>\t<version>
+        auto fields = split(line, "\t");
+        if (fields.size() == 4)
+            this->cache[fields[0]] = Entry{fields[1], fields[2], fields[3]};
+    }
+}
+
+void cmd::ToolRegistry::save() const
+{
+    std::error_code ec;
+    fs::create_directories(Resource::cache(), ec);
+    std::ostringstream oss;
+    for (const auto &[name, entry] : this->cache)
+        oss << name << "\t" << entry.path.string() << "\t" << entry.mtime << "\t" << entry.version << "\n";
+    // Written aside and renamed, as other cup processes may read it at the same time.
+    auto temp = Resource::cache() / "tools.cache.tmp";
+    temp += std::to_string(std::random_device{}());
+    std::ofstream(temp, std::ios::binary) << oss.str();
+    fs::rename(temp, Resource::cache() / "tools.cache", ec);
+    if (ec)
+        fs::remove(temp, ec);
+}
+
+std::optional<cmd::Tool> cmd::ToolRegistry::find(const std::string &name)
+{
+    std::lock_guard lock(this->mutex);
+    if (auto iter = this->tools.find(name); iter != this->tools.end())
+        return iter->second;
+    if (!this->loaded)
+        this->load();
+
+    std::optional<Tool> tool;
+    if (auto path = which(name))
+    {
+        auto mtime = stamp(*path);
+        auto iter = this->cache.find(name);
+        if (iter != this->cache.end() && iter->second.path == *path && iter->second.mtime == mtime)
+            tool = Tool{name, *path, iter->second.version};
+        else if (auto version = query_version(*path))
+        {
+            LOG_DEBUG("Found tool ", name, " ", *version, " at ", path->string());
+            tool = Tool{name, *path, *version};
+            this->cache[name] = Entry{*path, mtime, *version};
+            this->save();
+        }
+    }
+    this->tools[name] = tool;
+    return tool;
+}
+
+cmd::Tool cmd::ToolRegistry::require(const std::string &name)
+{
+    auto tool = this->find(name);
+    if (!tool)
+        throw std::runtime_error(name + " is not installed.");
+    return *tool;
+}
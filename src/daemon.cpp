@@ -0,0 +1,530 @@
+#include "daemon.h"
+#include "subcmd.h"
+#include "watcher.h"
+#include "toolchain.h"
+#include "cmd/jobserver.h"
+#include "res.h"
+#include "log.h"
+#include "utils/utils.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <csignal>
+#include <atomic>
+#include <thread>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+/// The standard streams of the client are passed to the daemon along with the request.
+static constexpr int STD_FDS = 3;
+/// Followed by the pipe of the jobserver of an outer make, if it is advertised by descriptors.
+static constexpr int MAX_FDS = STD_FDS + 2;
+/// The answer of the daemon when the client has to build by itself.
+static constexpr int32_t REFUSED = -1;
+
+/// Set when the daemon is interrupted while it serves a request.
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_interrupt(int)
+{
+    interrupted = 1;
+}
+
+/// @brief A request of a client: its working directory, command line and environment.
+struct Request
+{
+    fs::path cwd;
+    std::vector<std::string> argv;
+    std::vector<std::string> env;
+    std::vector<int> fds;
+};
+
+static sockaddr_un socket_address(const fs::path &path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.string().size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("The socket path is too long: " + path.string());
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+static int connect_to(const fs::path &path)
+{
+    if (!fs::exists(path) || path.string().size() >= sizeof(sockaddr_un::sun_path))
+        return -1;
+    auto addr = socket_address(path);
+    auto sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1)
+        return -1;
+    if (::connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static bool send_all(int sock, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        auto n = ::send(sock, data, size, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool recv_all(int sock, char *data, size_t size)
+{
+    while (size > 0)
+    {
+        auto n = ::recv(sock, data, size, 0);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static std::vector<std::string> get_environment()
+{
+    std::vector<std::string> entries;
+    for (auto entry = environ; *entry != nullptr; entry++)
+        entries.emplace_back(*entry);
+    return entries;
+}
+
+static void set_environment(const std::vector<std::string> &entries)
+{
+    clearenv();
+    for (const auto &entry : entries)
+        if (auto equal = entry.find('='); equal != std::string::npos && equal > 0)
+            setenv(entry.substr(0, equal).c_str(), entry.substr(equal + 1).c_str(), 1);
+}
+
+/// @brief Point a jobserver advertised by descriptors in `MAKEFLAGS` to the descriptors of the daemon.
+/// @param jobserver The pipe received from the client, or nothing to drop the jobserver.
+static std::string relocate_jobserver(const std::string &makeflags, std::optional<std::pair<int, int>> jobserver)
+{
+    std::vector<std::string> words;
+    for (const auto &word : split(makeflags, " "))
+    {
+        if ((word.starts_with("--jobserver-auth=") || word.starts_with("--jobserver-fds=")) &&
+            !word.starts_with("--jobserver-auth=fifo:"))
+        {
+            // The numbers of the client may be open in the daemon for something else.
+            if (jobserver)
+                words.push_back("--jobserver-auth=" + std::to_string(jobserver->first) + "," +
+                                std::to_string(jobserver->second));
+        }
+        else
+            words.push_back(word);
+    }
+    return join(words, " ");
+}
+
+/// @brief Send a request: the working directory, the command line and the environment, with the
+///        standard streams and the jobserver attached.
+/// @return The exit code of the command, or nothing if there is no daemon or it refused the request.
+static std::optional<int> request(const fs::path &socket_path, const std::vector<std::string> &argv)
+{
+    auto sock = connect_to(socket_path);
+    if (sock == -1)
+        return std::nullopt;
+    std::string payload = fs::current_path().string() + '\0' + std::to_string(argv.size());
+    for (const auto &arg : argv)
+        payload += '\0' + arg;
+    for (const auto &entry : get_environment())
+        payload += '\0' + entry;
+    uint32_t size = payload.size();
+    std::vector<int> fds{STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    if (auto jobserver = cmd::JobServer::descriptors())
+    {
+        fds.push_back(jobserver->first);
+        fds.push_back(jobserver->second);
+    }
+
+    iovec iov{.iov_base = &size, .iov_len = sizeof(size)};
+    char control[CMSG_SPACE(sizeof(int) * MAX_FDS)]{};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    // An interrupted client closes the connection, which cancels the build of the daemon.
+    int32_t code = 0;
+    std::fflush(stdout);
+    auto ok = ::sendmsg(sock, &msg, MSG_NOSIGNAL) == sizeof(size) &&
+              send_all(sock, payload.data(), payload.size()) &&
+              recv_all(sock, reinterpret_cast<char *>(&code), sizeof(code));
+    close(sock);
+    if (!ok)
+        throw std::runtime_error("Lost the connection to the daemon.");
+    if (code == REFUSED)
+    {
+        LOG_INFO("The daemon runs with other compilers or PATH, build without it.");
+        return std::nullopt;
+    }
+    return code;
+}
+
+/// @brief Receive a request sent by `request`.
+static std::optional<Request> receive(int conn)
+{
+    uint32_t size = 0;
+    iovec iov{.iov_base = &size, .iov_len = sizeof(size)};
+    char control[CMSG_SPACE(sizeof(int) * MAX_FDS)]{};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(conn, &msg, MSG_CMSG_CLOEXEC) != sizeof(size))
+        return std::nullopt;
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS)
+        return std::nullopt;
+    Request request;
+    request.fds.resize((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+    std::memcpy(request.fds.data(), CMSG_DATA(cmsg), sizeof(int) * request.fds.size());
+    auto fail = [&request]()
+    {
+        for (auto fd : request.fds)
+            close(fd);
+        return std::nullopt;
+    };
+    if (request.fds.size() != STD_FDS && request.fds.size() != MAX_FDS)
+        return fail();
+    std::string payload(size, '\0');
+    if (!recv_all(conn, payload.data(), payload.size()))
+        return fail();
+    auto strings = split(payload, std::string(1, '\0'));
+    size_t argc = 0;
+    try
+    {
+        argc = strings.size() < 2 ? 0 : std::stoul(strings[1]);
+    }
+    catch (const std::exception &)
+    {
+    }
+    if (argc < 1 || argc > strings.size() - 2)
+        return fail();
+    request.cwd = strings[0];
+    request.argv.assign(strings.begin() + 2, strings.begin() + 2 + argc);
+    request.env.assign(strings.begin() + 2 + argc, strings.end());
+    return request;
+}
+#endif
+
+Daemon::Daemon(const cmd::Args &args) : SubCommand(args)
+{
+    if (args.has_config("dir") && !args.getConfig().at("dir").empty())
+        this->root = args.getConfig().at("dir")[0];
+    else
+        this->root = ".";
+    if (this->root.is_relative())
+        this->root = fs::current_path() / this->root;
+    this->root = this->root.lexically_normal();
+    this->detach = args.has_flag("detach");
+    this->stop = args.getPositions().size() > 1 && args.getPositions()[1] == "stop";
+    if (!fs::exists(this->root / "cup.toml"))
+        throw std::runtime_error("The directory '" + this->root.string() + "' is not a cup project.");
+}
+
+int Daemon::run()
+{
+#ifdef __linux__
+    auto socket_path = Resource::socket(this->root);
+    if (this->stop)
+    {
+        if (!request(socket_path, {"cup", "daemon", "stop"}))
+            throw std::runtime_error("No daemon is running for " + this->root.string());
+        LOG_INFO("Daemon stopped.");
+        return 0;
+    }
+    {
+        auto sock = connect_to(socket_path);
+        if (sock != -1)
+        {
+            close(sock);
+            throw std::runtime_error("A daemon is already running for " + this->root.string());
+        }
+    }
+    if (!fs::exists(socket_path.parent_path()))
+        fs::create_directories(socket_path.parent_path());
+    if (fs::exists(socket_path))
+        fs::remove(socket_path);
+
+    auto addr = socket_address(socket_path);
+    auto sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1 ||
+        ::bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(sock, 16) != 0)
+        throw std::runtime_error("Failed to listen on " + socket_path.string());
+    LOG_INFO("Daemon listening on ", socket_path.string());
+
+    if (this->detach)
+    {
+        auto pid = fork();
+        if (pid == -1)
+            throw std::runtime_error("Failed to start the daemon in background.");
+        if (pid > 0)
+        {
+            LOG_INFO("Daemon started in background (pid ", pid, ").");
+            close(sock);
+            return 0;
+        }
+        setsid();
+        auto null = open("/dev/null", O_RDWR);
+        for (int fd = 0; fd < STD_FDS; fd++)
+            dup2(null, fd);
+        close(null);
+    }
+    // So that cancelling a request interrupts the build tools of the daemon and nothing else.
+    if (getpgrp() != getpid())
+        setpgid(0, 0);
+    auto ret = this->serve(sock);
+    close(sock);
+    fs::remove(socket_path);
+    return ret;
+#else
+    throw std::runtime_error("The daemon is not supported on this platform.");
+#endif
+}
+
+int Daemon::serve(int sock)
+{
+#ifdef __linux__
+    Watcher watcher;
+    std::unique_ptr<Build> warm;
+    std::string warm_key;
+    const auto toolchain = ToolchainCache::environment();
+    // Wakes up the watchdog of a request when it ends.
+    int done[2];
+    if (pipe2(done, O_CLOEXEC) != 0)
+        throw std::runtime_error("Failed to wait for requests.");
+
+    auto invalidate = [&]()
+    {
+        for (const auto &event : watcher.read())
+            if (event.structural && warm)
+            {
+                LOG_INFO("Changed: ", event.path.string());
+                warm.reset();
+            }
+    };
+
+    while (true)
+    {
+        pollfd pfds[2] = {
+            {.fd = sock, .events = POLLIN, .revents = 0},
+            {.fd = watcher.handle(), .events = POLLIN, .revents = 0},
+        };
+        if (poll(pfds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Failed to wait for requests.");
+        }
+        if (pfds[1].revents & POLLIN)
+            invalidate();
+        if (!(pfds[0].revents & POLLIN))
+            continue;
+
+        auto conn = ::accept4(sock, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn == -1)
+            continue;
+        auto request = receive(conn);
+        if (!request)
+        {
+            close(conn);
+            continue;
+        }
+        // Events may be queued since the last poll.
+        invalidate();
+
+        std::vector<char *> argv;
+        for (auto &arg : request->argv)
+            argv.push_back(arg.data());
+        argv.push_back(nullptr);
+        cmd::Args args(static_cast<int>(argv.size() - 1), argv.data());
+        auto subcmd = args.getPositions().empty() ? std::string() : args.getPositions()[0];
+
+        int saved[STD_FDS];
+        std::fflush(stdout);
+        std::cout.flush();
+        for (int fd = 0; fd < STD_FDS; fd++)
+        {
+            saved[fd] = dup(fd);
+            dup2(request->fds[fd], fd);
+            close(request->fds[fd]);
+        }
+        // The request runs with the environment of the client, and the build tools share the
+        // jobserver of its outer make through the descriptors passed along.
+        std::optional<std::pair<int, int>> jobserver;
+        if (request->fds.size() == MAX_FDS)
+        {
+            jobserver = std::make_pair(request->fds[STD_FDS], request->fds[STD_FDS + 1]);
+            fcntl(jobserver->first, F_SETFD, 0);
+            fcntl(jobserver->second, F_SETFD, 0);
+        }
+        for (auto &entry : request->env)
+            if (entry.starts_with("MAKEFLAGS="))
+                entry = "MAKEFLAGS=" + relocate_jobserver(entry.substr(10), jobserver);
+        auto env = get_environment();
+        set_environment(request->env);
+
+        // The client closes the connection when it is interrupted. The build tools of the
+        // daemon are then interrupted too, until the request ends.
+        struct sigaction action{}, previous{};
+        action.sa_handler = on_interrupt;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, &previous);
+        std::atomic<bool> cancelled{false};
+        auto watch = [conn, &done, &cancelled]()
+        {
+            pollfd pfds[2] = {
+                {.fd = conn, .events = POLLRDHUP, .revents = 0},
+                {.fd = done[0], .events = POLLIN, .revents = 0},
+            };
+            while (true)
+            {
+                if (poll(pfds, 2, cancelled ? 100 : -1) < 0 && errno != EINTR)
+                    return;
+                if (pfds[1].revents & POLLIN)
+                    return;
+                if (pfds[0].revents & (POLLRDHUP | POLLHUP | POLLERR))
+                {
+                    cancelled = true;
+                    pfds[0].fd = -1;
+                }
+                // Again and again, as the build may start other tools after the first ones.
+                if (cancelled)
+                    kill(0, SIGINT);
+            }
+        };
+        std::thread watchdog(watch);
+
+        auto cwd = fs::current_path();
+        int32_t code = 0;
+        try
+        {
+            fs::current_path(request->cwd);
+            if (subcmd == "daemon")
+                this->stop = true;
+            else if (subcmd != "build" && subcmd != "run")
+                throw std::runtime_error("The daemon cannot run '" + subcmd + "'.");
+            else if (ToolchainCache::environment() != toolchain)
+                // The versions of the tools and the generation of the daemon depend on them.
+                code = REFUSED;
+            else
+            {
+                std::unique_ptr<Build> command;
+                if (subcmd == "run")
+                    command = std::make_unique<Run>(args);
+                else
+                    command = std::make_unique<Build>(args);
+                auto key = command->generation_key();
+                auto reused = warm && warm_key == key;
+                if (reused)
+                {
+                    LOG_INFO("Reuse the generation of the daemon.");
+                    command->reuse_generation(*warm);
+                }
+                else
+                    warm.reset();
+                code = command->run();
+                if (!reused)
+                {
+                    watcher.clear();
+                    for (const auto &package : command->get_packages())
+                        watcher.watch_package(package);
+                    warm = std::make_unique<Build>(static_cast<const Build &>(*command));
+                    warm_key = key;
+                }
+            }
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR(cancelled ? "Cancelled by the client." : e.what());
+            code = 1;
+        }
+        char byte = 0;
+        if (write(done[1], &byte, 1) == 1)
+        {
+            watchdog.join();
+            while (read(done[0], &byte, 1) != 1 && errno == EINTR)
+                ;
+        }
+        else
+            watchdog.detach();
+        sigaction(SIGINT, &previous, nullptr);
+        // Interrupted from the terminal of the daemon rather than by the client.
+        if (interrupted && !cancelled)
+            this->stop = true;
+        interrupted = 0;
+
+        set_environment(env);
+        if (jobserver)
+        {
+            close(jobserver->first);
+            close(jobserver->second);
+        }
+        std::fflush(stdout);
+        std::cout.flush();
+        for (int fd = 0; fd < STD_FDS; fd++)
+        {
+            dup2(saved[fd], fd);
+            close(saved[fd]);
+        }
+        std::error_code ec;
+        fs::current_path(cwd, ec);
+        send_all(conn, reinterpret_cast<const char *>(&code), sizeof(code));
+        close(conn);
+        if (this->stop)
+            break;
+    }
+    close(done[0]);
+    close(done[1]);
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+std::optional<int> Daemon::forward(const cmd::Args &args, int argc, char **argv)
+{
+#ifdef __linux__
+    if (args.getPositions().empty())
+        return std::nullopt;
+    const auto &subcmd = args.getPositions()[0];
+    if (subcmd != "build" && subcmd != "run")
+        return std::nullopt;
+    fs::path root = ".";
+    if (args.has_config("dir") && !args.getConfig().at("dir").empty())
+        root = args.getConfig().at("dir")[0];
+    if (root.is_relative())
+        root = fs::current_path() / root;
+    return request(Resource::socket(root.lexically_normal()), std::vector<std::string>(argv, argv + argc));
+#else
+    return std::nullopt;
+#endif
+}
@@ -0,0 +1,193 @@
+#include "fingerprint.h"
+#include "plugin/built-in/scanner.h"
+#include "utils/utils.h"
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+
+/// At most this many files are named when the source files of a package change.
+static constexpr size_t MAX_LISTED = 5;
+
+static std::string read_binary(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+/// @brief Describe the entries only in `a`.
+static std::string difference(const std::vector<std::string> &a, const std::vector<std::string> &b)
+{
+    std::set<std::string> set_b(b.begin(), b.end());
+    std::vector<std::string> result;
+    size_t count = 0;
+    for (const auto &item : a)
+        if (!set_b.contains(item) && count++ < MAX_LISTED)
+            result.push_back(item);
+    if (count > MAX_LISTED)
+        result.push_back("and " + std::to_string(count - MAX_LISTED) + " more");
+    return count ? join(result, ", ") : "";
+}
+
+/// @brief Name the entries which differ, each entry being `<name...> <hash>`.
+static std::string changed_names(const std::vector<std::string> &a, const std::vector<std::string> &b)
+{
+    std::set<std::string> names;
+    auto collect = [&names](const std::vector<std::string> &x, const std::vector<std::string> &y)
+    {
+        for (const auto &entry : x)
+            if (std::find(y.begin(), y.end(), entry) == y.end())
+                names.insert(entry.substr(0, entry.rfind(' ')));
+    };
+    collect(a, b);
+    collect(b, a);
+    return join(std::vector<std::string>(names.begin(), names.end()), ", ");
+}
+
+std::string Fingerprint::hash(const std::string &data)
+{
+    uint64_t value = 14695981039346656037ull;
+    for (unsigned char c : data)
+    {
+        value ^= c;
+        value *= 1099511628211ull;
+    }
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+Fingerprint Fingerprint::of(const CMakeContext &ctx, bool is_dependency, const std::string &type,
+                            const PluginInputs &inputs, std::vector<std::string> dependencies)
+{
+    Fingerprint fingerprint;
+    fingerprint.manifest = hash(read_binary(ctx.current_dir / "cup.toml"));
+    fingerprint.features = join(ctx.features, " ") + " | " +
+                           join(std::vector<std::string>(ctx.dependencies.begin(), ctx.dependencies.end()), " ");
+    auto &scanner = SourceScanner::instance();
+    for (const auto &[dir, recursive] : {std::pair{"src", true}, {"tests", false}, {"examples", false}})
+        for (const auto &file : scanner.scan(ctx.current_dir, ctx.current_dir / dir, recursive))
+            fingerprint.sources.push_back(file.lexically_relative(ctx.current_dir).generic_string());
+    std::sort(dependencies.begin(), dependencies.end());
+    fingerprint.dependencies = std::move(dependencies);
+    fingerprint.plugin = type + " " + inputs.version + (inputs.cache_key ? " " + *inputs.cache_key : "");
+    for (const auto &file : inputs.files)
+    {
+        auto path = file.is_relative() ? ctx.current_dir / file : file;
+        fingerprint.inputs.push_back("file " + file.generic_string() + " " +
+                                     (fs::exists(path) ? hash(read_binary(path)) : "missing"));
+    }
+    for (const auto &pattern : inputs.globs)
+    {
+        // The list of matching files and their timestamps stand for their content.
+        std::string listing;
+        for (const auto &path : scanner.expand(ctx.current_dir, pattern))
+        {
+            std::error_code ec;
+            listing += path.generic_string() + " " +
+                       std::to_string(fs::last_write_time(path, ec).time_since_epoch().count()) + "\n";
+        }
+        fingerprint.inputs.push_back("glob " + pattern + " " + hash(listing));
+    }
+    for (const auto &name : inputs.env)
+    {
+        auto value = std::getenv(name.c_str());
+        fingerprint.inputs.push_back("env " + name + " " + (value ? hash(value) : "unset"));
+    }
+    fingerprint.context = hash(ctx.name + "\n" + ctx.root_dir.generic_string() + "\n" +
+                               std::to_string(ctx.cmake_version.first) + "." +
+                               std::to_string(ctx.cmake_version.second) + "\n" +
+                               (is_dependency ? "dependency" : "root"));
+    return fingerprint;
+}
+
+std::string Fingerprint::digest() const
+{
+    return hash(this->manifest + "\n" + this->features + "\n" + join(this->sources, "\n") + "\n" +
+                join(this->dependencies, "\n") + "\n" + this->plugin + "\n" + join(this->inputs, "\n") + "\n" +
+                this->context);
+}
+
+std::vector<std::string> Fingerprint::diff(const Fingerprint &old) const
+{
+    std::vector<std::string> result;
+    if (this->manifest != old.manifest)
+        result.push_back("cup.toml changed");
+    if (this->features != old.features)
+        result.push_back("features changed: [" + old.features + "] -> [" + this->features + "]");
+    if (this->sources != old.sources)
+    {
+        auto added = difference(this->sources, old.sources);
+        auto removed = difference(old.sources, this->sources);
+        if (!added.empty())
+            result.push_back("source files added: " + added);
+        if (!removed.empty())
+            result.push_back("source files removed: " + removed);
+    }
+    if (this->dependencies != old.dependencies)
+        result.push_back("dependencies changed: " + changed_names(this->dependencies, old.dependencies));
+    if (this->plugin != old.plugin)
+        result.push_back("plugin changed: " + old.plugin + " -> " + this->plugin);
+    if (this->inputs != old.inputs)
+        result.push_back("plugin inputs changed: " + changed_names(this->inputs, old.inputs));
+    if (this->context != old.context)
+        result.push_back("build context changed");
+    return result;
+}
+
+std::optional<Fingerprint> Fingerprint::load(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs.is_open())
+        return std::nullopt;
+    Fingerprint fp;
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        auto space = line.find(' ');
+        auto key = line.substr(0, space);
+        auto value = space == std::string::npos ? "" : line.substr(space + 1);
+        if (key == "manifest")
+            fp.manifest = value;
+        else if (key == "features")
+            fp.features = value;
+        else if (key == "source")
+            fp.sources.push_back(value);
+        else if (key == "dependency")
+            fp.dependencies.push_back(value);
+        else if (key == "plugin")
+            fp.plugin = value;
+        else if (key == "input")
+            fp.inputs.push_back(value);
+        else if (key == "context")
+            fp.context = value;
+        else
+            return std::nullopt;
+    }
+    if (ifs.bad() || fp.manifest.empty())
+        return std::nullopt;
+    return fp;
+}
+
+void Fingerprint::save(const fs::path &file) const
+{
+    if (!fs::exists(file.parent_path()))
+        fs::create_directories(file.parent_path());
+    std::ostringstream oss;
+    oss << "manifest " << this->manifest << "\n"
+        << "features " << this->features << "\n";
+    for (const auto &source : this->sources)
+        oss << "source " << source << "\n";
+    for (const auto &dep : this->dependencies)
+        oss << "dependency " << dep << "\n";
+    oss << "plugin " << this->plugin << "\n";
+    for (const auto &input : this->inputs)
+        oss << "input " << input << "\n";
+    oss << "context " << this->context << "\n";
+    std::ofstream ofs(file, std::ios::binary);
+    ofs << oss.str();
+}
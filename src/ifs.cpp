@@ -0,0 +1,257 @@
+#include "ifs.h"
+#include "fingerprint.h"
+#include <map>
+#include <cstdint>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+namespace
+{
+    /// The values of the ELF format which matter to the dynamic interface of a file.
+    namespace elf
+    {
+        constexpr uint64_t DYNAMIC = 6;
+        constexpr uint64_t DYNSYM = 11;
+        constexpr uint64_t VERDEF = 0x6ffffffd;
+        constexpr uint64_t VERSYM = 0x6fffffff;
+        constexpr uint64_t NEEDED = 1;
+        constexpr uint64_t SONAME = 14;
+        constexpr uint8_t OBJECT = 1;
+        constexpr uint8_t FUNC = 2;
+        constexpr uint8_t TLS = 6;
+        constexpr uint8_t GNU_IFUNC = 10;
+        constexpr uint8_t WEAK = 2;
+        constexpr uint64_t UNDEF = 0;
+    }
+
+    /// @brief Read the integers of an ELF file in its byte order.
+    struct Bytes
+    {
+        std::string_view data;
+        bool big_endian{false};
+
+        uint64_t get(uint64_t offset, size_t width) const
+        {
+            if (offset > this->data.size() || width > this->data.size() - offset)
+                throw std::out_of_range("The file is truncated.");
+            uint64_t value = 0;
+            for (size_t i = 0; i < width; i++)
+            {
+                auto byte = static_cast<uint64_t>(static_cast<unsigned char>(this->data[offset + i]));
+                value |= byte << (8 * (this->big_endian ? width - 1 - i : i));
+            }
+            return value;
+        }
+
+        /// @brief Get a string of a string table.
+        std::string str(uint64_t table, uint64_t table_size, uint64_t offset) const
+        {
+            if (offset >= table_size || table > this->data.size() || table_size > this->data.size() - table)
+                return "";
+            auto value = this->data.substr(table + offset, table_size - offset);
+            return std::string(value.substr(0, value.find('\0')));
+        }
+    };
+
+    struct Header
+    {
+        uint64_t type, offset, size, link, entsize;
+    };
+
+    /// @brief Describe the dynamic interface of an ELF file in the text format of `llvm-ifs`.
+    /// @return The stub, or nothing if the file is not an ELF file with section headers.
+    std::optional<std::string> read_elf(std::string_view data)
+    {
+        if (data.size() < 52 || data.substr(0, 4) != "\x7f"
+                                                     "ELF")
+            return std::nullopt;
+        auto is64 = data[4] == 2;
+        Bytes bytes{data, data[5] == 2};
+        try
+        {
+            auto shoff = is64 ? bytes.get(0x28, 8) : bytes.get(0x20, 4);
+            auto shentsize = bytes.get(is64 ? 0x3a : 0x2e, 2);
+            auto shnum = bytes.get(is64 ? 0x3c : 0x30, 2);
+            if (shoff == 0)
+                return std::nullopt;
+            auto header = [&](uint64_t i)
+            {
+                auto base = shoff + i * shentsize;
+                if (is64)
+                    return Header{bytes.get(base + 4, 4), bytes.get(base + 24, 8), bytes.get(base + 32, 8),
+                                  bytes.get(base + 40, 4), bytes.get(base + 56, 8)};
+                return Header{bytes.get(base + 4, 4), bytes.get(base + 16, 4), bytes.get(base + 20, 4),
+                              bytes.get(base + 24, 4), bytes.get(base + 36, 4)};
+            };
+            if (shnum == 0)
+                shnum = header(0).size;
+            if (shnum > data.size() / std::max<uint64_t>(shentsize, 1))
+                return std::nullopt;
+            std::vector<Header> headers;
+            for (uint64_t i = 0; i < shnum; i++)
+                headers.push_back(header(i));
+            auto find = [&headers](uint64_t type)
+            {
+                auto iter = std::find_if(headers.begin(), headers.end(),
+                                         [type](const Header &h) { return h.type == type; });
+                return iter == headers.end() ? std::optional<Header>() : std::optional<Header>(*iter);
+            };
+
+            std::ostringstream oss;
+            oss << "--- !ifs-v1\n"
+                << "IfsVersion: 3.0\n"
+                << "Target: { ObjectFormat: ELF, Endianness: " << (bytes.big_endian ? "big" : "little")
+                << ", BitWidth: " << (is64 ? 64 : 32) << ", Arch: " << bytes.get(0x12, 2) << " }\n";
+
+            std::vector<std::string> needed;
+            if (auto dynamic = find(elf::DYNAMIC))
+            {
+                const auto &strings = headers.at(dynamic->link);
+                auto entsize = dynamic->entsize ? dynamic->entsize : (is64 ? 16 : 8);
+                for (uint64_t i = 0; i < dynamic->size / entsize; i++)
+                {
+                    auto base = dynamic->offset + i * entsize;
+                    auto tag = bytes.get(base, is64 ? 8 : 4);
+                    auto value = bytes.get(base + (is64 ? 8 : 4), is64 ? 8 : 4);
+                    if (tag == elf::SONAME)
+                        oss << "SoName: " << bytes.str(strings.offset, strings.size, value) << "\n";
+                    else if (tag == elf::NEEDED)
+                        needed.push_back(bytes.str(strings.offset, strings.size, value));
+                }
+            }
+            if (!needed.empty())
+            {
+                oss << "NeededLibs:\n";
+                for (const auto &name : needed)
+                    oss << "  - " << name << "\n";
+            }
+
+            // The names of the versions defined by the library, by their index.
+            std::map<uint64_t, std::string> versions;
+            if (auto verdef = find(elf::VERDEF))
+            {
+                const auto &strings = headers.at(verdef->link);
+                auto offset = verdef->offset;
+                while (true)
+                {
+                    auto index = bytes.get(offset + 4, 2);
+                    auto aux = bytes.get(offset + 12, 4);
+                    auto next = bytes.get(offset + 16, 4);
+                    versions[index] = bytes.str(strings.offset, strings.size, bytes.get(offset + aux, 4));
+                    if (next == 0)
+                        break;
+                    offset += next;
+                }
+            }
+
+            // Sorted by name, so that the order of the table does not change the stub.
+            std::map<std::string, std::string> symbols;
+            auto versym = find(elf::VERSYM);
+            if (auto table = find(elf::DYNSYM))
+            {
+                const auto &strings = headers.at(table->link);
+                auto entsize = table->entsize ? table->entsize : (is64 ? 24 : 16);
+                for (uint64_t i = 1; i < table->size / entsize; i++)
+                {
+                    auto base = table->offset + i * entsize;
+                    uint64_t name, info, shndx, size;
+                    if (is64)
+                    {
+                        name = bytes.get(base, 4);
+                        info = bytes.get(base + 4, 1);
+                        shndx = bytes.get(base + 6, 2);
+                        size = bytes.get(base + 16, 8);
+                    }
+                    else
+                    {
+                        name = bytes.get(base, 4);
+                        size = bytes.get(base + 8, 4);
+                        info = bytes.get(base + 12, 1);
+                        shndx = bytes.get(base + 14, 2);
+                    }
+                    if (shndx == elf::UNDEF)
+                        continue;
+                    auto type = static_cast<uint8_t>(info & 0xf);
+                    auto binding = static_cast<uint8_t>(info >> 4);
+                    auto symbol = bytes.str(strings.offset, strings.size, name);
+                    if (versym)
+                    {
+                        // The hidden bit marks the versions which are not the default one.
+                        auto index = bytes.get(versym->offset + i * 2, 2);
+                        if (auto iter = versions.find(index & 0x7fff); iter != versions.end() && iter->first > 1)
+                            symbol += ((index & 0x8000) ? "@" : "@@") + iter->second;
+                    }
+                    std::string line = "{ Name: " + symbol + ", Type: ";
+                    if (type == elf::FUNC || type == elf::GNU_IFUNC)
+                        line += "Func";
+                    else if (type == elf::OBJECT)
+                        line += "Object, Size: " + std::to_string(size);
+                    else if (type == elf::TLS)
+                        line += "TLS, Size: " + std::to_string(size);
+                    else
+                        line += "NoType";
+                    if (binding == elf::WEAK)
+                        line += ", Weak: true";
+                    symbols[symbol] = line + " }";
+                }
+            }
+            oss << "Symbols:\n";
+            for (const auto &[_, line] : symbols)
+                oss << "  - " << line << "\n";
+            oss << "...\n";
+            return oss.str();
+        }
+        catch (const std::out_of_range &)
+        {
+            return std::nullopt;
+        }
+    }
+
+    std::string read_binary(const fs::path &file)
+    {
+        std::ifstream ifs(file, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+}
+
+InterfaceStub::InterfaceStub(const cmd::Args &args) : SubCommand(args)
+{
+    const auto &positions = args.getPositions();
+    if (positions.size() < 3)
+        throw std::runtime_error("Usage: cup ifs <library> <stub>");
+    this->library = positions[1];
+    this->stub = positions[2];
+}
+
+std::string InterfaceStub::of(const fs::path &library)
+{
+    if (!fs::is_regular_file(library))
+        throw std::runtime_error("Cannot read the library " + library.string());
+    auto data = read_binary(library);
+    if (auto stub = read_elf(data))
+        return *stub;
+    return "--- !ifs-v1\nDigest: " + Fingerprint::hash(data) + "\n...\n";
+}
+
+int InterfaceStub::run()
+{
+    auto content = of(this->library);
+    if (fs::exists(this->stub) && read_binary(this->stub) == content)
+        return 0;
+    // Written aside and renamed, so that an interrupted build never leaves half a stub.
+    auto temp = this->stub;
+    temp += ".tmp";
+    if (!this->stub.parent_path().empty())
+        fs::create_directories(this->stub.parent_path());
+    {
+        std::ofstream ofs(temp, std::ios::binary);
+        ofs << content;
+    }
+    fs::rename(temp, this->stub);
+    return 0;
+}
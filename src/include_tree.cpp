@@ -0,0 +1,128 @@
+#include "include_tree.h"
+#include "log.h"
+#include "res.h"
+#include <map>
+#include <set>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+static std::string read_binary(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+static bool write_if_changed(const fs::path &file, const std::string &content)
+{
+    if (fs::exists(file) && fs::file_size(file) == content.size() && read_binary(file) == content)
+        return false;
+    fs::create_directories(file.parent_path());
+    std::ofstream ofs(file, std::ios::binary);
+    ofs << content;
+    return true;
+}
+
+/// @brief Get the file listing the packages merged into the tree, one directory per line.
+static fs::path list_file(const fs::path &root)
+{
+    return Resource::build(root) / "include.list";
+}
+
+fs::path IncludeTree::directory(const fs::path &root)
+{
+    return Resource::build(root) / "include";
+}
+
+std::vector<fs::path> IncludeTree::sync(const fs::path &root, const std::vector<std::pair<fs::path, fs::path>> &dirs)
+{
+    // The name of each link in the tree, with its target and the package providing it.
+    std::map<std::string, std::pair<fs::path, fs::path>> links;
+    std::vector<fs::path> merged;
+#ifdef _WIN32
+    // Creating symbolic links needs the developer mode or administrator rights.
+    if (!dirs.empty())
+        LOG_WARN("The unified include layout is not supported on Windows, the include directories are kept separate.");
+#else
+    std::set<fs::path> visited;
+    for (const auto &[package, dir] : dirs)
+    {
+        if (!visited.insert(package).second || !fs::is_directory(dir))
+            continue;
+        std::map<std::string, std::pair<fs::path, fs::path>> entries;
+        auto conflict = links.end();
+        for (const auto &entry : fs::directory_iterator(dir))
+        {
+            auto name = entry.path().filename().string();
+            conflict = links.find(name);
+            if (conflict != links.end())
+                break;
+            entries[name] = {entry.path(), package};
+        }
+        if (conflict != links.end())
+        {
+            LOG_DEBUG("Keep the include directory of ", package, " separate, '", conflict->first,
+                      "' is also provided by ", conflict->second.second);
+            continue;
+        }
+        links.merge(entries);
+        merged.push_back(package);
+    }
+#endif
+
+    auto tree = directory(root);
+    if (links.empty())
+    {
+        fs::remove_all(tree);
+        fs::remove(list_file(root));
+        return {};
+    }
+    // Links which still point to the same entry are kept, so the tree is not touched by an
+    // unchanged graph.
+    fs::create_directories(tree);
+    std::vector<fs::path> stale;
+    for (const auto &entry : fs::directory_iterator(tree))
+    {
+        auto iter = links.find(entry.path().filename().string());
+        std::error_code ec;
+        if (iter != links.end() && entry.is_symlink() && fs::read_symlink(entry.path(), ec) == iter->second.first)
+            links.erase(iter);
+        else
+            stale.push_back(entry.path());
+    }
+    for (const auto &path : stale)
+        fs::remove_all(path);
+    for (const auto &[name, link] : links)
+    {
+        if (fs::is_directory(link.first))
+            fs::create_directory_symlink(link.first, tree / name);
+        else
+            fs::create_symlink(link.first, tree / name);
+    }
+
+    std::ostringstream oss;
+    for (const auto &package : merged)
+        oss << package.lexically_normal().generic_string() << "\n";
+    write_if_changed(list_file(root), oss.str());
+    return merged;
+}
+
+bool IncludeTree::contains(const fs::path &root, const fs::path &package)
+{
+    auto file = list_file(root);
+    if (!fs::exists(file))
+        return false;
+    std::istringstream iss(read_binary(file));
+    auto target = package.lexically_normal().generic_string();
+    std::string line;
+    while (std::getline(iss, line))
+        if (line == target)
+            return true;
+    return false;
+}
+
+fs::path IncludeTree::public_dir(const fs::path &root, const fs::path &package, const fs::path &dir)
+{
+    return contains(root, package) ? directory(root) : dir;
+}
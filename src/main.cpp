@@ -1,5 +1,11 @@
 #include "cup_plugin/args.h"
 #include "subcmd.h"
+#include "daemon.h"
+#include "watch.h"
+#include "worker.h"
+#include "size.h"
+#include "ifs.h"
+#include "archive.h"
 #include <iostream>
 #include <unordered_map>
 #include <functional>
@@ -9,6 +15,9 @@ using namespace std;
 
 int main(int argc, char **argv)
 {
+    // The compiler command line of the launcher is not parsed as the arguments of cup.
+    if (argc > 1 && std::string(argv[1]) == "launch")
+        return Worker::launch(argc - 2, argv + 2);
     cmd::Args args(argc, argv);
 #ifdef _DEBUG
     cout << args << endl;
@@ -24,6 +33,16 @@ int main(int argc, char **argv)
         auto help = Help(args);
         return help.run();
     }
+    try
+    {
+        if (auto ret = Daemon::forward(args, argc, argv))
+            return *ret;
+    }
+    catch (const exception &e)
+    {
+        LOG_ERROR(e.what());
+        return 1;
+    }
     const unordered_map<string, function<int(void)>> subcmd_goto_map = {
         {
             "help",
@@ -97,6 +116,62 @@ int main(int argc, char **argv)
                 return run.run();
             },
         },
+        {
+            "daemon",
+            [&]()
+            {
+                auto daemon = Daemon(args);
+                return daemon.run();
+            },
+        },
+        {
+            "watch",
+            [&]()
+            {
+                auto watch = Watch(args);
+                return watch.run();
+            },
+        },
+        {
+            "worker",
+            [&]()
+            {
+                auto worker = Worker(args);
+                return worker.run();
+            },
+        },
+        {
+            "size",
+            [&]()
+            {
+                auto size = Size(args);
+                return size.run();
+            },
+        },
+        {
+            "ifs",
+            [&]()
+            {
+                auto ifs = InterfaceStub(args);
+                return ifs.run();
+            },
+        },
+        {
+            "ar",
+            [&]()
+            {
+                auto ar = ThinArchive(args);
+                return ar.run();
+            },
+        },
+        {
+            "plugin-host",
+            [&]()
+            {
+                auto host = PluginHostMode(args);
+                return host.run();
+            },
+        },
     };
     if (subcmd_goto_map.contains(args.getPositions()[0]))
     {
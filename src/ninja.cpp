@@ -0,0 +1,656 @@
+#include "ninja.h"
+#include "res.h"
+#include "fingerprint.h"
+#include "include_tree.h"
+#include "utils/utils.h"
+#include "plugin/built-in/utils.h"
+#include "plugin/built-in/scanner.h"
+#include "toml/default/binary.h"
+#include "toml/default/static.h"
+#include "toml/default/interface.h"
+#include <set>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+/// The value of `CMAKE_SYSTEM_NAME` matched by the `[target.<name>]` tables.
+static const std::string SYSTEM_NAME =
+#ifdef __APPLE__
+    "Darwin"
+#else
+    "Linux"
+#endif
+    ;
+/// The value of `CMAKE_GENERATOR` matched by the `[generator.<name>]` tables.
+static const std::string GENERATOR = "Ninja";
+
+static const std::set<std::string> C_SOURCES = {".c"};
+static const std::set<std::string> CXX_SOURCES = {".cpp", ".cc", ".cxx", ".c++", ".C"};
+static const std::set<std::string> HEADERS = {".h", ".hh", ".h++", ".hm", ".hpp", ".hxx", ".in", ".txx"};
+
+static std::string read_binary(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+static bool write_if_changed(const fs::path &file, const std::string &content)
+{
+    if (fs::exists(file) && fs::file_size(file) == content.size() && read_binary(file) == content)
+        return false;
+    fs::create_directories(file.parent_path());
+    std::ofstream ofs(file, std::ios::binary);
+    ofs << content;
+    return true;
+}
+
+/// @brief Get the content of a config header, as written by the templates of the built-in plugins.
+static std::string config_header(const std::vector<std::string> &defines)
+{
+    std::string content = "// Generated by cup, do not edit.\n#pragma once\n";
+    for (const auto &define : defines)
+    {
+        auto name = define.starts_with("-D") ? define.substr(2) : define;
+        auto eq = name.find('=');
+        content += "#define " + (eq == std::string::npos ? name + " 1" : name.substr(0, eq) + " " + name.substr(eq + 1)) +
+                   "\n";
+    }
+    return content;
+}
+
+/// @brief Quote an argument for the shell running the commands of ninja.
+static std::string quote(const std::string &arg)
+{
+    static const std::string safe = "+-./:=@_%,";
+    auto plain = !arg.empty() && std::all_of(arg.begin(), arg.end(), [](char c)
+                                             { return std::isalnum(static_cast<unsigned char>(c)) ||
+                                                      safe.find(c) != std::string::npos; });
+    if (plain)
+        return arg;
+    std::string result = "'";
+    for (auto c : arg)
+        result += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    return result + "'";
+}
+
+/// @brief Escape a value of a ninja variable.
+static std::string escape(const std::string &value)
+{
+    std::string result;
+    for (auto c : value)
+        result += c == '$' ? std::string("$$") : std::string(1, c);
+    return result;
+}
+
+/// @brief Escape a path of a build statement.
+static std::string escape_path(const fs::path &path)
+{
+    std::string result;
+    for (auto c : path.generic_string())
+    {
+        if (c == '$' || c == ' ' || c == ':')
+            result += '$';
+        result += c;
+    }
+    return result;
+}
+
+static std::string join_args(const std::string &prefix, const std::vector<std::string> &args)
+{
+    std::string result;
+    for (const auto &arg : args)
+        result += " " + escape(quote(prefix + arg));
+    return result;
+}
+
+/// @brief Append a table of a manifest, such as `[build]` or `[feature.<name>]`.
+/// @param base The directory which relative paths are resolved against, as CMake does.
+/// @param features Set if the table has `compiler_features`, which need CMake.
+template <class T>
+static void append(NinjaBackend::Flags &flags, const std::optional<T> &part, const fs::path &base, bool &features)
+{
+    if (!part)
+        return;
+    auto paths = [&base](const std::optional<std::vector<fs::path>> &list, auto &out)
+    {
+        for (const auto &path : list.value_or(std::vector<fs::path>{}))
+            out.push_back((base / path).lexically_normal());
+    };
+    auto strings = [](const std::optional<std::vector<std::string>> &list, std::vector<std::string> &out)
+    {
+        if (list)
+            out.insert(out.end(), list->begin(), list->end());
+    };
+    std::vector<fs::path> includes, link_dirs;
+    paths(part->includes, includes);
+    paths(part->link_dirs, link_dirs);
+    for (const auto &path : includes)
+        flags.includes.push_back(path.string());
+    for (const auto &path : link_dirs)
+        flags.link_dirs.push_back(path.string());
+    paths(part->sources, flags.sources);
+    strings(part->link_libs, flags.libs);
+    strings(part->defines, flags.defines);
+    strings(part->compile_options, flags.compile_options);
+    strings(part->link_options, flags.link_options);
+    features = features || (part->compiler_features && !part->compiler_features->empty());
+}
+
+/// @brief Append a table and the table of the build type in it.
+template <class T>
+static void append_mode(NinjaBackend::Flags &flags, const std::optional<T> &part, const fs::path &base,
+                        bool is_release, bool &features)
+{
+    append(flags, part, base, features);
+    if (part)
+        append(flags, is_release ? part->release : part->debug, base, features);
+}
+
+/// @brief Merge the tables of a manifest in the order of the templates of the built-in plugins:
+///        `[target]`, `[build]`, `[generator]`, the include directory, then `[feature]`.
+/// @return The position of the dependencies in the libraries.
+template <class Config>
+static size_t merge(NinjaBackend::Package &package, const Config &config, const PackageNode &node,
+                    const fs::path &base, bool is_release, bool &features)
+{
+    auto &flags = package.flags;
+    if (config.target && config.target->contains(SYSTEM_NAME))
+        append_mode(flags, std::optional(config.target->at(SYSTEM_NAME)), base, is_release, features);
+    append_mode(flags, config.build, base, is_release, features);
+    if (config.generator && config.generator->contains(GENERATOR))
+        append_mode(flags, std::optional(config.generator->at(GENERATOR)), base, is_release, features);
+    auto deps_at = flags.libs.size();
+    // The public headers may be found in the unified include tree instead.
+    auto public_dir = [&node](const std::string &name)
+    { return IncludeTree::public_dir(node.ctx.root_dir, node.ctx.current_dir, node.ctx.current_dir / name).string(); };
+    if (package.type == "static")
+    {
+        flags.includes.push_back(public_dir("export"));
+        package.private_flags.includes.push_back((node.ctx.current_dir / "include").string());
+    }
+    else
+        flags.includes.push_back(public_dir("include"));
+
+    std::vector<std::string> feats;
+    if (node.is_dependency)
+        feats = get_features(node.ctx.features, config.features);
+    else if (config.build)
+        feats = get_features(config.build->features, config.features);
+    for (const auto &[name, cfg] : config.feature.value_or(data::Table<data::Feature>{}))
+        if (std::find(feats.begin(), feats.end(), name) != feats.end())
+            append_mode(flags, std::optional(cfg), base, is_release, features);
+
+    append_mode(package.tests, config.tests, base, is_release, features);
+    if constexpr (requires { config.examples; })
+        append_mode(package.examples, config.examples, base, is_release, features);
+    if (config.build && config.build->stdc)
+        package.stdc = std::to_string(*config.build->stdc);
+    if (config.build && config.build->stdcxx)
+        package.stdcxx = std::to_string(*config.build->stdcxx);
+    package.config_header = config_header_of(config.build);
+
+    // With `[build.public]`, the other settings of a library only apply to its own sources.
+    if (package.type == "static" && config.build && config.build->public_data)
+    {
+        auto &own = package.private_flags;
+        auto move = [](auto &from, auto &to)
+        {
+            to.insert(to.end(), from.begin(), from.end());
+            from.clear();
+        };
+        move(flags.includes, own.includes);
+        move(flags.link_dirs, own.link_dirs);
+        move(flags.defines, own.defines);
+        move(flags.compile_options, own.compile_options);
+        move(flags.link_options, own.link_options);
+        flags.includes.push_back(public_dir("export"));
+        append_mode(flags, config.build->public_data, base, is_release, features);
+        package.public_table = true;
+    }
+    return deps_at;
+}
+
+void NinjaBackend::Flags::append(const Flags &other)
+{
+    auto extend = [](auto &a, const auto &b)
+    { a.insert(a.end(), b.begin(), b.end()); };
+    extend(this->includes, other.includes);
+    extend(this->link_dirs, other.link_dirs);
+    extend(this->libs, other.libs);
+    extend(this->defines, other.defines);
+    extend(this->compile_options, other.compile_options);
+    extend(this->link_options, other.link_options);
+    extend(this->sources, other.sources);
+}
+
+NinjaBackend::NinjaBackend(const fs::path &root, bool is_release, const std::string &launcher, bool thin_archives)
+    : root(root), is_release(is_release), launcher(launcher), thin_archives(thin_archives), dir(directory(root)) {}
+
+fs::path NinjaBackend::directory(const fs::path &root)
+{
+    return Resource::build(root) / "ninja";
+}
+
+std::optional<std::string> NinjaBackend::collect(const std::vector<PackageNode> &nodes)
+{
+    // Packages of the same name are merged into the latest version, as for CMake.
+    std::unordered_map<std::string, size_t> latest;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        auto [iter, inserted] = latest.emplace(nodes[i].block.name, i);
+        if (!inserted && nodes[i].block.version > nodes[iter->second].block.version)
+            iter->second = i;
+    }
+    std::unordered_map<size_t, size_t> index_of;
+    auto base = Resource::build(this->root);
+    auto &scanner = SourceScanner::instance();
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const auto &node = nodes[i];
+        if (latest.at(node.block.name) != i)
+            continue;
+        if (node.type != "binary" && node.type != "static" && node.type != "interface")
+            return "package " + node.block.name + " is of type '" + node.type + "'";
+
+        Package package;
+        package.name = node.block.name;
+        package.type = node.type;
+        package.stem = node.block.name + "-" + Fingerprint::hash(node.block.path.generic_string()).substr(0, 8);
+        package.dir = node.ctx.current_dir;
+        package.is_dependency = node.is_dependency;
+        package.profile = node.block.profile;
+        auto features = false;
+        size_t deps_at = 0;
+        std::string version;
+        auto src = node.ctx.current_dir / "src";
+        if (node.type == "binary")
+        {
+            auto config = data::parse_toml_file<data::Binary>(node.ctx.current_dir / "cup.toml");
+            version = config.project.version;
+            deps_at = merge(package, config, node, base, this->is_release, features);
+            if (!fs::exists(src))
+                throw std::runtime_error("Cannot find required directory 'src' in project root directory.");
+            for (const auto &file : scanner.scan(node.ctx.current_dir, src, false))
+                if (file.stem() == "main")
+                    package.main_file = file;
+            if (!package.main_file)
+                throw std::runtime_error("Cannot find required file 'main' in 'src' directory.");
+            for (const auto &file : scanner.scan(node.ctx.current_dir, src))
+            {
+                auto relative = file.lexically_relative(src).parent_path();
+                if (file.stem() != "main" && std::none_of(relative.begin(), relative.end(), [](const fs::path &p)
+                                                          { return p.stem() == "bin"; }))
+                    package.sources.push_back(file);
+            }
+            package.test_mains = scanner.scan(node.ctx.current_dir, node.ctx.current_dir / "tests", false);
+        }
+        else if (node.type == "static")
+        {
+            auto config = data::parse_toml_file<data::Static>(node.ctx.current_dir / "cup.toml");
+            version = config.project.version;
+            deps_at = merge(package, config, node, base, this->is_release, features);
+            if (!fs::exists(src))
+                throw std::runtime_error("Cannot find required directory 'src' in project root directory.");
+            package.sources = scanner.scan(node.ctx.current_dir, src);
+            package.test_mains = scanner.scan(node.ctx.current_dir, node.ctx.current_dir / "tests", false);
+            package.example_mains = scanner.scan(node.ctx.current_dir, node.ctx.current_dir / "examples", false);
+        }
+        else
+        {
+            auto config = data::parse_toml_file<data::Interface>(node.ctx.current_dir / "cup.toml");
+            version = config.project.version;
+            deps_at = merge(package, config, node, base, this->is_release, features);
+            package.test_mains = scanner.scan(node.ctx.current_dir, node.ctx.current_dir / "tests", false);
+            package.example_mains = scanner.scan(node.ctx.current_dir, node.ctx.current_dir / "examples", false);
+        }
+        if (features)
+            return "package " + package.name + " uses compiler_features";
+        package.unique = package.name + "_" + replace(version, ".", "_");
+
+        // The dependencies are linked by name at their place among the libraries.
+        std::vector<std::string> deps;
+        for (const auto &[name, index] : node.dependencies)
+        {
+            deps.push_back(nodes[index].block.name);
+            package.dependencies.push_back(latest.at(nodes[index].block.name));
+        }
+        package.flags.libs.insert(package.flags.libs.begin() + deps_at, deps.begin(), deps.end());
+
+        std::vector<fs::path> all = package.sources;
+        for (const auto *list : {&package.flags.sources, &package.tests.sources, &package.examples.sources,
+                                 &package.test_mains, &package.example_mains})
+            all.insert(all.end(), list->begin(), list->end());
+        if (package.main_file)
+            all.push_back(*package.main_file);
+        for (const auto &file : all)
+        {
+            auto ext = file.extension().string();
+            if (!C_SOURCES.contains(ext) && !CXX_SOURCES.contains(ext) && !HEADERS.contains(ext))
+                return "package " + package.name + " has '" + ext + "' sources";
+        }
+        // The defines are moved to the config header, which is written with the build files.
+        if (package.config_header)
+        {
+            auto dir = this->dir / "config" / package.stem;
+            auto &flags = package.public_table ? package.private_flags : package.flags;
+            package.config_header = dir / *package.config_header;
+            package.config_defines = std::exchange(flags.defines, {});
+            flags.includes.push_back(dir.string());
+        }
+        if (package.type == "static")
+            package.archive = (Resource::lib(node.ctx.root_dir) / ("lib" + package.name + ".a")).generic_string();
+        index_of[i] = this->packages.size();
+        this->packages.push_back(std::move(package));
+    }
+    for (auto &package : this->packages)
+        for (auto &dep : package.dependencies)
+            dep = index_of.at(dep);
+    return std::nullopt;
+}
+
+namespace
+{
+    /// @brief The build statements of the targets of a package.
+    class Writer
+    {
+        const std::vector<NinjaBackend::Package> &packages;
+        const NinjaBackend::Package &package;
+        std::unordered_map<std::string, size_t> by_name;
+        std::string mode_flags;
+        std::ostringstream out;
+        std::vector<std::string> &defaults;
+
+        /// @brief The packages used by a target through its libraries, dependents first.
+        std::vector<size_t> closure(const std::vector<std::string> &libs) const
+        {
+            std::vector<size_t> order;
+            std::set<size_t> visited;
+            std::function<void(size_t)> visit = [&](size_t index)
+            {
+                if (!visited.insert(index).second)
+                    return;
+                for (const auto &lib : packages[index].flags.libs)
+                    if (by_name.contains(lib))
+                        visit(by_name.at(lib));
+                order.push_back(index);
+            };
+            for (const auto &lib : libs)
+                if (by_name.contains(lib))
+                    visit(by_name.at(lib));
+            return std::vector<size_t>(order.rbegin(), order.rend());
+        }
+
+        std::string link_item(const std::string &lib) const
+        {
+            if (lib.starts_with("-") || lib.find('/') != std::string::npos || lib.ends_with(".a") ||
+                lib.ends_with(".so") || lib.ends_with(".dylib"))
+                return lib;
+            return "-l" + lib;
+        }
+
+        std::string object_of(const std::string &target, const fs::path &source) const
+        {
+            auto relative = source.lexically_relative(package.dir);
+            auto name = !relative.empty() && *relative.begin() != ".."
+                            ? relative.generic_string()
+                            : "_ext/" + Fingerprint::hash(source.generic_string()).substr(0, 8) + "-" +
+                                  source.filename().string();
+            return "obj/" + package.stem + "/" + target + "/" + name + ".o";
+        }
+
+    public:
+        Writer(const std::vector<NinjaBackend::Package> &packages, const NinjaBackend::Package &package,
+               bool is_release, std::vector<std::string> &defaults)
+            : packages(packages), package(package), defaults(defaults)
+        {
+            for (size_t i = 0; i < packages.size(); i++)
+                by_name[packages[i].name] = i;
+            // `add_compile_definitions()` of the generated script and the flags of the build type.
+            this->mode_flags = is_release ? " -O3 -DNDEBUG -D_NDEBUG" : " -g -DDEBUG -D_DEBUG";
+            this->out << "# Generated by cup for " << package.dir.generic_string() << "\n\n";
+        }
+
+        /// @brief Write the objects and the output of a target.
+        /// @param target The name of the target.
+        /// @param flags The settings of the target itself.
+        /// @param own The settings of the target which are not in `flags` and not used by its consumers.
+        /// @param sources The sources to compile, headers are skipped.
+        /// @param output The archive or executable, or nothing for no output.
+        /// @param executable Whether `output` is linked as an executable.
+        void target(const std::string &target, const NinjaBackend::Flags &flags, const NinjaBackend::Flags &own,
+                    std::vector<fs::path> sources, const std::optional<std::string> &output, bool executable)
+        {
+            auto used = this->closure(flags.libs);
+            auto with_own = [](const std::vector<std::string> &list, const std::vector<std::string> &more)
+            {
+                auto result = list;
+                result.insert(result.end(), more.begin(), more.end());
+                return result;
+            };
+            auto includes = with_own(flags.includes, own.includes);
+            auto defines = with_own(flags.defines, own.defines);
+            auto options = with_own(flags.compile_options, own.compile_options);
+            auto link_options = with_own(flags.link_options, own.link_options);
+            auto link_dirs = with_own(flags.link_dirs, own.link_dirs);
+            for (auto index : used)
+            {
+                const auto &dep = packages[index];
+                includes.insert(includes.end(), dep.flags.includes.begin(), dep.flags.includes.end());
+                options.insert(options.end(), dep.flags.compile_options.begin(), dep.flags.compile_options.end());
+                link_options.insert(link_options.end(), dep.flags.link_options.begin(), dep.flags.link_options.end());
+                link_dirs.insert(link_dirs.end(), dep.flags.link_dirs.begin(), dep.flags.link_dirs.end());
+                // Everything of an interface library is a usage requirement, the defines of other
+                // libraries only with `[build.public]`.
+                if (dep.type == "interface" || dep.public_table)
+                    defines.insert(defines.end(), dep.flags.defines.begin(), dep.flags.defines.end());
+                if (dep.type == "interface")
+                    sources.insert(sources.end(), dep.flags.sources.begin(), dep.flags.sources.end());
+            }
+            // A directory is searched at its first position only, so the later ones of a deep
+            // graph, such as the unified include tree of every library, are dropped.
+            std::unordered_set<std::string> searched;
+            std::erase_if(includes, [&searched](const std::string &dir)
+                          { return !searched.insert(fs::path(dir).lexically_normal().generic_string()).second; });
+
+            auto common = this->mode_flags + join_args("-D", defines) + join_args("-I", includes) +
+                          join_args("", options) + join_args("", package.profile);
+            auto variable = replace(target, "-", "_");
+            this->out << "flags_c_" << variable << " =" << common
+                      << (package.stdc.empty() ? "" : " -std=gnu" + package.stdc) << " $cflags\n"
+                      << "flags_cxx_" << variable << " =" << common
+                      << (package.stdcxx.empty() ? "" : " -std=gnu++" + package.stdcxx) << " $cxxflags\n";
+
+            std::vector<std::string> objects;
+            auto has_cxx = false;
+            for (const auto &source : sources)
+            {
+                auto ext = source.extension().string();
+                if (HEADERS.contains(ext))
+                    continue;
+                auto is_cxx = CXX_SOURCES.contains(ext);
+                has_cxx = has_cxx || is_cxx;
+                auto object = this->object_of(target, source);
+                objects.push_back(object);
+                this->out << "build " << escape_path(object) << ": " << (is_cxx ? "cxx " : "cc ")
+                          << escape_path(source) << "\n"
+                          << "  flags = $flags_" << (is_cxx ? "cxx_" : "c_") << variable << "\n";
+            }
+            if (!output)
+                return;
+
+            this->out << "build " << escape_path(*output) << ": " << (executable ? "link" : "ar");
+            for (const auto &object : objects)
+                this->out << " " << escape_path(object);
+            if (executable)
+            {
+                // The libraries of the target, with those of each package after its archive.
+                std::vector<std::string> items;
+                std::vector<std::string> archives;
+                auto literals = [&](const std::vector<std::string> &libs)
+                {
+                    for (const auto &lib : libs)
+                        if (!by_name.contains(lib))
+                            items.push_back(this->link_item(lib));
+                };
+                literals(flags.libs);
+                for (auto index : used)
+                {
+                    const auto &dep = packages[index];
+                    if (dep.archive)
+                    {
+                        items.push_back(*dep.archive);
+                        archives.push_back(*dep.archive);
+                    }
+                    has_cxx = has_cxx || dep.type == "static";
+                    literals(dep.flags.libs);
+                }
+                if (!archives.empty())
+                {
+                    this->out << " |";
+                    for (const auto &archive : archives)
+                        this->out << " " << escape_path(archive);
+                }
+                this->out << "\n"
+                          << "  ld = " << (has_cxx ? "$cxx" : "$cc") << "\n"
+                          << "  ldflags =" << join_args("", link_options) << join_args("-L", link_dirs)
+                          << join_args("", items) << " $ldflags\n";
+            }
+            else
+                this->out << "\n";
+            this->out << "build " << escape_path(target) << ": phony " << escape_path(*output) << "\n\n";
+            this->defaults.push_back(*output);
+        }
+
+        std::string content() const { return this->out.str(); }
+    };
+
+    /// @brief Get the name of a file up to its first dot, as `NAME_WE` of CMake.
+    std::string name_we(const fs::path &file)
+    {
+        auto name = file.filename().string();
+        return name.substr(0, name.find('.'));
+    }
+}
+
+std::string NinjaBackend::write_package(const Package &package, std::vector<std::string> &defaults) const
+{
+    Writer writer(this->packages, package, this->is_release, defaults);
+    auto bin = Resource::bin(this->root);
+    if (package.type == "binary")
+    {
+        auto sources = package.sources;
+        sources.push_back(*package.main_file);
+        sources.insert(sources.end(), package.flags.sources.begin(), package.flags.sources.end());
+        auto name = package.name + "_" + package.unique;
+        writer.target(name, package.flags, {}, sources, (bin / package.name).generic_string(), true);
+
+        for (const auto &main : package.test_mains)
+        {
+            auto flags = package.flags;
+            flags.append(package.tests);
+            auto test_sources = package.sources;
+            test_sources.push_back(main);
+            test_sources.insert(test_sources.end(), flags.sources.begin(), flags.sources.end());
+            // `NAME_WLE`, the name without the last extension.
+            auto test = main.stem().string();
+            writer.target("test_" + test + "_" + name, flags, {}, test_sources,
+                          (bin / "tests" / test).generic_string(), true);
+        }
+        return writer.content();
+    }
+
+    // An interface library has nothing to build, its settings are used by its consumers.
+    if (package.type == "static")
+    {
+        auto sources = package.sources;
+        sources.insert(sources.end(), package.flags.sources.begin(), package.flags.sources.end());
+        writer.target(package.name, package.flags, package.private_flags, sources, package.archive, false);
+    }
+    if (package.is_dependency)
+        return writer.content();
+    // Tests and examples link to the library, which brings its usage requirements.
+    for (const auto &[mains, flags, prefix, out_dir] :
+         {std::tuple{&package.test_mains, &package.tests, "test_", bin / "tests"},
+          std::tuple{&package.example_mains, &package.examples, "example_", bin / "examples"}})
+        for (const auto &main : *mains)
+        {
+            auto target_flags = *flags;
+            target_flags.libs.insert(target_flags.libs.begin(), package.name);
+            auto target_sources = flags->sources;
+            target_sources.insert(target_sources.begin(), main);
+            writer.target(prefix + name_we(main) + "_" + package.unique, target_flags, {}, target_sources,
+                          (out_dir / name_we(main)).generic_string(), true);
+        }
+    return writer.content();
+}
+
+std::optional<std::string> NinjaBackend::generate(const std::vector<PackageNode> &nodes)
+{
+#ifdef _WIN32
+    return std::string("it is not supported on Windows");
+#endif
+    this->packages.clear();
+    this->changed_.clear();
+    if (auto reason = this->collect(nodes))
+        return reason;
+
+    auto env = [](const char *name, const std::string &fallback)
+    {
+        auto value = std::getenv(name);
+        return value && *value ? std::string(value) : fallback;
+    };
+    std::string archive = "$ar qc $out $in";
+#ifndef __APPLE__
+    // Thin archives are written by `cup ar`, see `[build] thin_archives`. The ar of macOS has none.
+    if (auto exe = Resource::executable(); this->thin_archives && !exe.empty())
+        archive = escape(exe.generic_string()) + " ar $ar $out $in";
+#endif
+    std::ostringstream main;
+    main << "# Generated by cup\n"
+         << "ninja_required_version = 1.3\n\n"
+         << "cc = " << escape(env("CC", "cc")) << "\n"
+         << "cxx = " << escape(env("CXX", "c++")) << "\n"
+         << "launcher = " << escape(this->launcher) << "\n"
+         << "ar = " << escape(env("AR", "ar")) << "\n"
+         << "cflags = " << escape(env("CFLAGS", "")) << "\n"
+         << "cxxflags = " << escape(env("CXXFLAGS", "")) << "\n"
+         << "ldflags = " << escape(env("LDFLAGS", "")) << "\n\n"
+         << "rule cc\n"
+         << "  command = $launcher $cc -MD -MF $out.d $flags -c $in -o $out\n"
+         << "  description = Building C object $out\n"
+         << "  depfile = $out.d\n"
+         << "  deps = gcc\n\n"
+         << "rule cxx\n"
+         << "  command = $launcher $cxx -MD -MF $out.d $flags -c $in -o $out\n"
+         << "  description = Building CXX object $out\n"
+         << "  depfile = $out.d\n"
+         << "  deps = gcc\n\n"
+         << "rule ar\n"
+         << "  command = rm -f $out && " << archive << " && $ar s $out\n"
+         << "  description = Linking static library $out\n\n"
+         << "rule link\n"
+         << "  command = $ld $in $ldflags -o $out\n"
+         << "  description = Linking executable $out\n\n";
+
+    std::vector<std::string> defaults;
+    for (const auto &package : this->packages)
+    {
+        auto file = package.stem + ".ninja";
+        if (package.config_header)
+            write_if_changed(*package.config_header, config_header(package.config_defines));
+        if (write_if_changed(this->dir / file, this->write_package(package, defaults)))
+            this->changed_.push_back(package.name);
+        main << "subninja " << escape_path(file) << "\n";
+    }
+    main << "\nbuild all: phony";
+    for (const auto &output : defaults)
+        main << " " << escape_path(output);
+    main << "\ndefault all\n";
+    write_if_changed(this->dir / "build.ninja", main.str());
+    return std::nullopt;
+}
@@ -4,6 +4,8 @@
 
 #include "plugin/built-in/binary.h"
 #include "plugin/built-in/utils.h"
+#include "plugin/built-in/lean.h"
+#include "plugin/built-in/scanner.h"
 #include "template.h"
 #include "utils/utils.h"
 #include "toml/default/binary.h"
@@ -11,23 +13,21 @@
 #include <fstream>
 #include <algorithm>
 
-void BinaryPlugin::_get_source_files(const fs::path &dir, std::vector<fs::path> &files)
-{
-    for (const auto &entry : fs::directory_iterator(dir))
-    {
-        if (entry.is_directory() && entry.path().stem() != "bin")
-            this->_get_source_files(entry.path(), files);
-        else if (entry.is_regular_file() && entry.path().stem() != "main" && is_source_file(entry.path()))
-            files.push_back(entry.path());
-    }
-}
-
 std::vector<fs::path> BinaryPlugin::get_source_files(const fs::path &root)
 {
-    std::vector<fs::path> source_files;
     if (!fs::exists(root / "src"))
         throw std::runtime_error("Cannot find required directory 'src' in project root directory.");
-    this->_get_source_files(root / "src", source_files);
+    auto src = root / "src";
+    std::vector<fs::path> source_files;
+    for (const auto &file : SourceScanner::instance().scan(root, src))
+    {
+        // The main files, including those under `bin` directories, are built as executables.
+        auto relative = file.lexically_relative(src).parent_path();
+        if (file.stem() != "main" &&
+            std::none_of(relative.begin(), relative.end(), [](const fs::path &p)
+                         { return p.stem() == "bin"; }))
+            source_files.push_back(file);
+    }
     return source_files;
 }
 
@@ -35,45 +35,20 @@ fs::path BinaryPlugin::get_main_file(const fs::path &root)
 {
     if (!fs::exists(root / "src"))
         throw std::runtime_error("Cannot find required directory 'src' in project root directory.");
-    auto src = root / "src";
-    std::optional<fs::path> main_file;
-    for (const auto &entry : fs::directory_iterator(src))
-    {
-        if (entry.is_regular_file() && entry.path().stem() == "main" && is_source_file(entry.path()))
-        {
-            main_file = entry.path();
-            break;
-        }
-    }
-    if (!main_file)
-        throw std::runtime_error("Cannot find required file 'main' in 'src' directory.");
-    return *main_file;
+    for (const auto &file : SourceScanner::instance().scan(root, root / "src", false))
+        if (file.stem() == "main")
+            return file;
+    throw std::runtime_error("Cannot find required file 'main' in 'src' directory.");
 }
 
 std::vector<fs::path> BinaryPlugin::get_bin_main_files(const fs::path &root)
 {
-    if (!fs::exists(root / "src" / "bin"))
-        return std::vector<fs::path>();
-    std::vector<fs::path> bin_main_files;
-    for (const auto &entry : fs::directory_iterator(root / "src" / "bin"))
-    {
-        if (entry.is_regular_file() && is_source_file(entry.path()))
-            bin_main_files.push_back(entry.path());
-    }
-    return bin_main_files;
+    return SourceScanner::instance().scan(root, root / "src" / "bin", false);
 }
 
 std::vector<fs::path> BinaryPlugin::get_tests_main_files(const fs::path &root)
 {
-    if (!fs::exists(root / "tests"))
-        return std::vector<fs::path>();
-    std::vector<fs::path> tests_main_files;
-    for (const auto &entry : fs::directory_iterator(root / "tests"))
-    {
-        if (entry.is_regular_file() && is_source_file(entry.path()))
-            tests_main_files.push_back(entry.path());
-    }
-    return tests_main_files;
+    return SourceScanner::instance().scan(root, root / "tests", false);
 }
 
 Result<std::string, std::string> BinaryPlugin::getName() const { return Ok<std::string, std::string>("binary"); }
@@ -260,7 +235,9 @@ Result<std::string, std::string> BinaryPlugin::gen_cmake(const CMakeContext &ctx
             replacements};
         for_tests.push_back(temp.getContent());
     }
-    return Ok<std::string>(FileTemplate{
+    auto sources = this->get_source_files(current_dir);
+    auto units = take_module_units(sources);
+    auto script = FileTemplate{
 #include "template/binary/binary.cmake"
         ,
         {
@@ -271,10 +248,12 @@ Result<std::string, std::string> BinaryPlugin::gen_cmake(const CMakeContext &ctx
             {"FOR_TARGET", join(for_target, "\n")},
             {"MAIN_FILE", dealpath(this->get_main_file(current_dir))},
             {"BIN_MAIN_FILES", join(this->get_bin_main_files(current_dir), " ", dealpath)},
-            {"SOURCES", join(this->get_source_files(current_dir), " ", dealpath)},
+            {"SOURCES", join(sources, " ", dealpath)},
+            {"FOR_MODULES", gen_modules(name, units, current_dir / "src", name + "_" + replace(config.project.version, ".", "_") + "_modules", true)},
             {"OUT_NAME", name},
             {"OUT_DIR", dealpath(Resource::bin(root_dir))},
             {"UNIQUE", name + "_" + replace(config.project.version, ".", "_")},
+            {"FOR_CONFIG", gen_config_header(config.build, root_dir, name + "_" + replace(config.project.version, ".", "_"))},
             {"TEST_MAIN_FILES", join(this->get_tests_main_files(current_dir), " ", dealpath)},
             {"TEST_OUT_DIR", dealpath(Resource::bin(root_dir) / "tests")},
             {"DEPS", join(deps, " ")},
@@ -283,7 +262,8 @@ Result<std::string, std::string> BinaryPlugin::gen_cmake(const CMakeContext &ctx
             {"STDCXX", config.build && config.build->stdcxx ? std::to_string(*config.build->stdcxx) : ""},
         },
     }
-                               .getContent());
+                      .getContent();
+    return Ok<std::string>(lean_enabled(ctx) ? lean_cmake(script) : script);
 }
 
 Result<fs::path, std::string> BinaryPlugin::run_project(const RunProjectData &data)
@@ -354,3 +334,8 @@ Result<int, std::string> BinaryPlugin::show_help(const cmd::Args &command) const
         ;
     return Ok<std::string>(0);
 }
+
+Result<PluginInputs, std::string> BinaryPlugin::declare_inputs(const CMakeContext &ctx, bool) const
+{
+    return built_in_inputs(ctx);
+}
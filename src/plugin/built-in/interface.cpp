@@ -4,6 +4,8 @@
 
 #include "plugin/built-in/interface.h"
 #include "plugin/built-in/utils.h"
+#include "plugin/built-in/lean.h"
+#include "plugin/built-in/scanner.h"
 #include "template.h"
 #include "res.h"
 #include "toml/default/interface.h"
@@ -12,28 +14,12 @@
 
 std::vector<fs::path> InterfacePlugin::get_all_tests_main_files(const fs::path &root)
 {
-    if (!fs::exists(root / "tests"))
-        return {};
-    std::vector<fs::path> result;
-    for (const auto &entry : fs::directory_iterator(root / "tests"))
-    {
-        if (entry.is_regular_file() && is_source_file(entry.path()))
-            result.push_back(entry.path());
-    }
-    return result;
+    return SourceScanner::instance().scan(root, root / "tests", false);
 }
 
 std::vector<fs::path> InterfacePlugin::get_examples_main_files(const fs::path &root)
 {
-    if (!fs::exists(root / "examples"))
-        return {};
-    std::vector<fs::path> result;
-    for (const auto &entry : fs::directory_iterator(root / "examples"))
-    {
-        if (entry.is_regular_file() && is_source_file(entry.path()))
-            result.push_back(entry.path());
-    }
-    return result;
+    return SourceScanner::instance().scan(root, root / "examples", false);
 }
 
 Result<std::string, std::string> InterfacePlugin::getName() const
@@ -241,7 +227,14 @@ Result<std::string, std::string> InterfacePlugin::gen_cmake(const CMakeContext &
             replacements};
         for_examples.push_back(temp.getContent());
     }
-    return Ok<std::string>(FileTemplate{
+    // An interface library has no sources, but may have module interface units.
+    std::vector<fs::path> units;
+    if (fs::exists(current_dir / "src"))
+    {
+        auto sources = SourceScanner::instance().scan(current_dir, current_dir / "src");
+        units = take_module_units(sources);
+    }
+    auto script = FileTemplate{
 #include "template/interface/interface.cmake"
         ,
         {
@@ -255,16 +248,19 @@ Result<std::string, std::string> InterfacePlugin::gen_cmake(const CMakeContext &
             {"IS_DEP", is_dependency ? "ON" : "OFF"},
             {"DEPS", join(deps, " ")},
             {"UNIQUE", name + "_" + replace(config.project.version, ".", "_")},
+            {"FOR_CONFIG", gen_config_header(config.build, root_dir, name + "_" + replace(config.project.version, ".", "_"))},
+            {"FOR_MODULES", gen_modules(name, units, current_dir / "src", name + "_" + replace(config.project.version, ".", "_") + "_modules", true)},
             {"TEST_MAIN_FILES", join(this->get_all_tests_main_files(current_dir), " ", dealpath)},
             {"TEST_OUT_DIR", dealpath(Resource::bin(root_dir) / "tests")},
             {"EXAMPLE_MAIN_FILES", join(this->get_examples_main_files(current_dir), " ", dealpath)},
             {"EXAMPLE_OUT_DIR", dealpath(Resource::bin(root_dir) / "examples")},
-            {"INC", dealpath(current_dir / "include")},
+            {"INC", dealpath(IncludeTree::public_dir(root_dir, current_dir, current_dir / "include"))},
             {"STDC", config.build && config.build->stdc ? std::to_string(*config.build->stdc) : ""},
             {"STDCXX", config.build && config.build->stdcxx ? std::to_string(*config.build->stdcxx) : ""},
         },
     }
-                               .getContent());
+                      .getContent();
+    return Ok<std::string>(lean_enabled(ctx) ? lean_cmake(script) : script);
 }
 
 Result<fs::path, std::string> InterfacePlugin::run_project(const RunProjectData &data)
@@ -333,3 +329,8 @@ Result<int, std::string> InterfacePlugin::show_help(const cmd::Args &command) co
         ;
     return Ok<std::string>(0);
 }
+
+Result<PluginInputs, std::string> InterfacePlugin::declare_inputs(const CMakeContext &ctx, bool) const
+{
+    return built_in_inputs(ctx);
+}
@@ -0,0 +1,364 @@
+#include "plugin/built-in/lean.h"
+#include "toml/default/default.h"
+#include <map>
+#include <mutex>
+#include <cctype>
+#include <optional>
+#include <set>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    /// @brief A line of the script, or an `if()` or `foreach()` block with its body.
+    struct Node
+    {
+        enum Kind
+        {
+            Line,
+            If,
+            Foreach,
+        } kind{Line};
+        std::string line;
+        /// Header and body of each branch: `if()`, `elseif()`, `else()` or `foreach()`.
+        std::vector<std::pair<std::string, std::vector<Node>>> branches;
+        std::string end;
+    };
+
+    bool is_name_char(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    std::string trim(const std::string &str)
+    {
+        auto begin = str.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+            return "";
+        auto end = str.find_last_not_of(" \t\r");
+        return str.substr(begin, end - begin + 1);
+    }
+
+    /// @brief Get the command name of a line, such as `if` for `if(...)`.
+    std::string command_of(const std::string &line)
+    {
+        auto text = trim(line);
+        size_t i = 0;
+        while (i < text.size() && is_name_char(text[i]))
+            i++;
+        return i < text.size() && text[i] == '(' ? text.substr(0, i) : "";
+    }
+
+    /// @brief Get the arguments of a single-line command, or nothing if it spans lines.
+    std::optional<std::string> arguments_of(const std::string &line)
+    {
+        auto text = trim(line);
+        auto open = text.find('(');
+        if (open == std::string::npos || text.back() != ')')
+            return std::nullopt;
+        return trim(text.substr(open + 1, text.size() - open - 2));
+    }
+
+    bool is_blank(const std::string &line)
+    {
+        auto text = trim(line);
+        return text.empty() || text[0] == '#';
+    }
+
+    std::vector<Node> parse(const std::vector<std::string> &lines, size_t &i, const std::set<std::string> &stop)
+    {
+        std::vector<Node> nodes;
+        while (i < lines.size())
+        {
+            auto command = command_of(lines[i]);
+            if (stop.contains(command))
+                return nodes;
+            Node node;
+            if (command == "if" || command == "foreach")
+            {
+                node.kind = command == "if" ? Node::If : Node::Foreach;
+                std::set<std::string> ends = command == "if" ? std::set<std::string>{"elseif", "else", "endif"}
+                                                             : std::set<std::string>{"endforeach"};
+                while (i < lines.size())
+                {
+                    auto header = lines[i++];
+                    auto body = parse(lines, i, ends);
+                    node.branches.emplace_back(header, std::move(body));
+                    if (i >= lines.size())
+                        break;
+                    auto next = command_of(lines[i]);
+                    if (next == "endif" || next == "endforeach")
+                    {
+                        node.end = lines[i++];
+                        break;
+                    }
+                }
+            }
+            else
+                node.line = lines[i++];
+            nodes.push_back(std::move(node));
+        }
+        return nodes;
+    }
+
+    bool is_empty(const std::vector<Node> &nodes)
+    {
+        for (const auto &node : nodes)
+            if (node.kind != Node::Line || !is_blank(node.line))
+                return false;
+        return true;
+    }
+
+    /// @brief Drop the branches which can never run and the blocks which do nothing.
+    std::vector<Node> simplify(std::vector<Node> nodes)
+    {
+        std::vector<Node> result;
+        for (auto &node : nodes)
+        {
+            for (auto &[_, body] : node.branches)
+                body = simplify(std::move(body));
+            if (node.kind == Node::Foreach)
+            {
+                // A loop over an empty list only names its variable.
+                auto args = arguments_of(node.branches[0].first);
+                if ((args && args->find_first_of(" \t") == std::string::npos) || is_empty(node.branches[0].second))
+                    continue;
+            }
+            else if (node.kind == Node::If)
+            {
+                // `if()` without a condition is false.
+                std::vector<std::pair<std::string, std::vector<Node>>> branches;
+                for (auto &branch : node.branches)
+                {
+                    auto command = command_of(branch.first);
+                    if (command != "else" && arguments_of(branch.first) == "")
+                        continue;
+                    branches.push_back(std::move(branch));
+                }
+                while (!branches.empty() && command_of(branches.back().first) == "else" &&
+                       is_empty(branches.back().second))
+                    branches.pop_back();
+                auto all_empty = true;
+                for (const auto &[_, body] : branches)
+                    all_empty = all_empty && is_empty(body);
+                if (branches.empty() || all_empty)
+                    continue;
+                auto first = command_of(branches[0].first);
+                if (first == "else")
+                {
+                    for (auto &inner : branches[0].second)
+                        result.push_back(std::move(inner));
+                    continue;
+                }
+                if (first == "elseif")
+                {
+                    auto &header = branches[0].first;
+                    header.erase(header.find("elseif"), 4);
+                }
+                node.branches = std::move(branches);
+            }
+            result.push_back(std::move(node));
+        }
+        return result;
+    }
+
+    void flatten(const std::vector<Node> &nodes, std::vector<std::string> &lines)
+    {
+        for (const auto &node : nodes)
+        {
+            if (node.kind == Node::Line)
+            {
+                lines.push_back(node.line);
+                continue;
+            }
+            for (const auto &[header, body] : node.branches)
+            {
+                lines.push_back(header);
+                flatten(body, lines);
+            }
+            lines.push_back(node.end);
+        }
+    }
+
+    /// The sections of the templates whose options are collected into lists, such as `TARGET_MODE_LIBS`.
+    const std::set<std::string> SECTIONS{"TARGET", "TARGET_MODE", "M", "MODE", "GEN", "GEN_MODE", "FEAT",
+                                         "PUB", "PUB_MODE", "TEST", "TEST_MODE", "EXAMPLE", "EXAMPLE_MODE"};
+    const char *const KINDS[] = {"INCLUDE_DIRS", "LIB_DIRS", "LIBS", "DEFINES",
+                                 "COPTIONS", "LINKOPTIONS", "SOURCES", "COMPILER_FEAT"};
+
+    /// @brief Check whether a variable is an option list declared by the templates.
+    bool is_option_list(const std::string &name)
+    {
+        for (std::string kind : KINDS)
+        {
+            if (!name.ends_with("_" + kind))
+                continue;
+            auto section = name.substr(0, name.size() - kind.size() - 1);
+            // `FEAT_<unique>_<kind>` and `FEAT_<unique>_MODE_<kind>` of each feature.
+            return SECTIONS.contains(section) || section.starts_with("FEAT_");
+        }
+        return false;
+    }
+
+    /// @brief Find the variables which are set to nothing wherever they are set.
+    /// @note The option lists of the sections which the manifest does not have are never set by
+    ///       the script, they are empty as well. Any other variable which is not set may come from
+    ///       outside of the script, such as `PROJECT_NAME` in an option, and is kept.
+    std::set<std::string> empty_variables(const std::vector<std::string> &lines)
+    {
+        std::map<std::string, size_t> empty_sets;
+        std::set<std::string> assigned;
+        std::set<std::string> referenced_names;
+        std::map<std::string, size_t> bare;
+        for (const auto &line : lines)
+        {
+            if (command_of(line) == "set")
+            {
+                auto args = arguments_of(line);
+                auto name = args ? args->substr(0, args->find_first_of(" \t")) : "";
+                if (args && *args == name && !name.empty())
+                    empty_sets[name]++;
+                else if (!name.empty())
+                    assigned.insert(name);
+            }
+            // Names outside of `${}` may be assigned by other commands, such as `foreach()`.
+            for (size_t i = 0; i < line.size();)
+            {
+                if (!is_name_char(line[i]))
+                {
+                    i++;
+                    continue;
+                }
+                auto start = i;
+                while (i < line.size() && is_name_char(line[i]))
+                    i++;
+                auto referenced = start >= 2 && line.compare(start - 2, 2, "${") == 0 && i < line.size() && line[i] == '}';
+                if (referenced)
+                    referenced_names.insert(line.substr(start, i - start));
+                else
+                    bare[line.substr(start, i - start)]++;
+            }
+        }
+        std::set<std::string> result;
+        for (const auto &[name, count] : empty_sets)
+            if (!assigned.contains(name) && bare[name] == count)
+                result.insert(name);
+        for (const auto &name : referenced_names)
+            if (!assigned.contains(name) && !empty_sets.contains(name) && !bare.contains(name) &&
+                is_option_list(name))
+                result.insert(name);
+        return result;
+    }
+
+    /// @brief Remove the variables, the references to them and the commands left without arguments.
+    std::vector<std::string> strip(const std::vector<std::string> &lines, const std::set<std::string> &variables)
+    {
+        std::vector<std::string> result;
+        for (auto line : lines)
+        {
+            for (size_t pos = line.find("${"); pos != std::string::npos; pos = line.find("${", pos))
+            {
+                auto close = line.find('}', pos);
+                if (close == std::string::npos || !variables.contains(line.substr(pos + 2, close - pos - 2)))
+                {
+                    pos += 2;
+                    continue;
+                }
+                line.erase(pos, close - pos + 1);
+                if (pos > 0 && line[pos - 1] == ' ' && (pos == line.size() || line[pos] == ' ' || line[pos] == ')'))
+                    line.erase(--pos, 1);
+            }
+            auto command = command_of(line);
+            auto args = arguments_of(line);
+            if (command == "set" && args && variables.contains(*args))
+                continue;
+            // `target_*(<target> PRIVATE)` without items.
+            if (command.starts_with("target_") && args)
+            {
+                auto space = args->find(' ');
+                auto scope = space == std::string::npos ? "" : trim(args->substr(space + 1));
+                if (scope == "PRIVATE" || scope == "PUBLIC" || scope == "INTERFACE")
+                    continue;
+            }
+            result.push_back(std::move(line));
+        }
+        return result;
+    }
+}
+
+std::string lean_cmake(const std::string &script)
+{
+    std::vector<std::string> lines;
+    {
+        std::istringstream iss(script);
+        std::string line;
+        while (std::getline(iss, line))
+            lines.push_back(line);
+    }
+    // Dropping a variable may leave others empty, as `set(LIBS ${A} ${B})` does.
+    while (true)
+    {
+        auto variables = empty_variables(lines);
+        auto stripped = strip(lines, variables);
+        size_t i = 0;
+        auto nodes = simplify(parse(stripped, i, {}));
+        std::vector<std::string> next;
+        flatten(nodes, next);
+        if (next == lines)
+            break;
+        lines = std::move(next);
+    }
+    std::string result;
+    auto blank = false;
+    for (const auto &line : lines)
+    {
+        // The markers left by the raw string literals of the templates.
+        if (trim(line) == "#" || trim(line) == "#\"")
+            continue;
+        auto is_empty_line = trim(line).empty();
+        if (is_empty_line && blank)
+            continue;
+        blank = is_empty_line;
+        result += line + "\n";
+    }
+    return result;
+}
+
+namespace
+{
+    std::mutex lean_mutex;
+    /// The projects asking for lean scripts, by root directory.
+    std::map<std::string, bool> lean_roots;
+
+    std::string key_of(const fs::path &root)
+    {
+        return (root / "").lexically_normal().generic_string();
+    }
+}
+
+bool lean_codegen(const std::optional<data::Build> &build)
+{
+    if (!build || !build->codegen || *build->codegen == "full")
+        return false;
+    if (*build->codegen != "lean")
+        throw std::runtime_error("Unknown codegen '" + *build->codegen + "', expected 'full' or 'lean'.");
+    return true;
+}
+
+void set_lean(const fs::path &root, bool lean)
+{
+    std::lock_guard lock(lean_mutex);
+    lean_roots[key_of(root)] = lean;
+}
+
+bool lean_enabled(const CMakeContext &ctx)
+{
+    {
+        std::lock_guard lock(lean_mutex);
+        if (auto iter = lean_roots.find(key_of(ctx.root_dir)); iter != lean_roots.end())
+            return iter->second;
+    }
+    auto config = data::parse_toml_file<data::Default>(ctx.root_dir / "cup.toml");
+    return lean_codegen(config.build);
+}
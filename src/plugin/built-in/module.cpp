@@ -4,47 +4,24 @@
 
 #include "plugin/built-in/module.h"
 #include "plugin/built-in/utils.h"
+#include "plugin/built-in/lean.h"
+#include "plugin/built-in/scanner.h"
 #include "template.h"
 #include "res.h"
 #include "utils/utils.h"
 #include "toml/default/module.h"
 #include <fstream>
 
-void ModulePlugin::_get_all_source_files(const fs::path &root, std::vector<fs::path> &src_files)
-{
-    for (const auto &entry : fs::directory_iterator(root))
-    {
-        if (entry.is_directory())
-        {
-            this->_get_all_source_files(entry.path(), src_files);
-        }
-        else if (entry.is_regular_file() && is_source_file(entry.path()))
-        {
-            src_files.push_back(entry.path());
-        }
-    }
-}
-
 std::vector<fs::path> ModulePlugin::get_all_source_files(const fs::path &root)
 {
     if (!fs::exists(root / "src"))
         throw std::runtime_error("Cannot find required directory 'src' in project root directory.");
-    std::vector<fs::path> files;
-    this->_get_all_source_files(root / "src", files);
-    return files;
+    return SourceScanner::instance().scan(root, root / "src");
 }
 
 std::vector<fs::path> ModulePlugin::get_test_main_files(const fs::path &root)
 {
-    if (!fs::exists(root / "tests"))
-        return std::vector<fs::path>();
-    std::vector<fs::path> files;
-    for (const auto &entry : fs::directory_iterator(root / "tests"))
-    {
-        if (entry.is_regular_file() && is_source_file(entry.path()))
-            files.push_back(entry.path());
-    }
-    return files;
+    return SourceScanner::instance().scan(root, root / "tests", false);
 }
 
 Result<std::string, std::string> ModulePlugin::getName() const
@@ -65,9 +42,16 @@ Result<int, std::string> ModulePlugin::run_new(const NewData &data)
         ofs << FileTemplate{
 #include "template/module/module.cpp.txt"
             ,
-            {{"NAME", name}}}
+            {{"NAME", name}, {"MACRO", macro_name(name)}}}
                    .getContent();
     }
+    {
+        // A module is only loaded at runtime, its header is never compiled outside of it.
+        auto include_dir = project / "include" / name;
+        fs::create_directories(include_dir);
+        std::ofstream ofs(include_dir / (name + "_export.h"));
+        ofs << gen_visibility_header(name, "1");
+    }
     {
         auto config = project / "cup.toml";
         std::ofstream ofs(config);
@@ -76,7 +60,8 @@ Result<int, std::string> ModulePlugin::run_new(const NewData &data)
             , {
                   {"NAME", name},
                   {"TYPE", type},
-              }}.getContent();
+              }}.getContent()
+            << "\n[build]\nvisibility = \"hidden\"\n";
     }
     {
         auto gitignore = project / ".gitignore";
@@ -235,7 +220,7 @@ Result<std::string, std::string> ModulePlugin::gen_cmake(const CMakeContext &ctx
             replacements};
         for_tests.push_back(temp.getContent());
     }
-    return Ok<std::string>(FileTemplate{
+    auto script = FileTemplate{
 #include "template/module/module.cmake"
         ,
         {
@@ -248,15 +233,18 @@ Result<std::string, std::string> ModulePlugin::gen_cmake(const CMakeContext &ctx
             {"OUT_NAME", name},
             {"OUT_DIR", dealpath(Resource::mod(root_dir))},
             {"UNIQUE", name + "_" + replace(config.project.version, ".", "_")},
+            {"FOR_CONFIG", gen_config_header(config.build, root_dir, name + "_" + replace(config.project.version, ".", "_"))},
             {"TEST_MAIN_FILES", join(this->get_test_main_files(current_dir), " ", dealpath)},
             {"TEST_OUT_DIR", dealpath(Resource::bin(root_dir) / "tests")},
             {"DEPS", join(deps, " ")},
             {"INC", dealpath(current_dir / "include")},
             {"STDC", config.build && config.build->stdc ? std::to_string(*config.build->stdc) : ""},
             {"STDCXX", config.build && config.build->stdcxx ? std::to_string(*config.build->stdcxx) : ""},
+            {"HIDDEN", hidden_visibility(config.build) ? "ON" : ""},
         },
     }
-                               .getContent());
+                      .getContent();
+    return Ok<std::string>(lean_enabled(ctx) ? lean_cmake(script) : script);
 }
 
 Result<fs::path, std::string> ModulePlugin::run_project(const RunProjectData &data)
@@ -311,3 +299,8 @@ Result<int, std::string> ModulePlugin::show_help(const cmd::Args &command) const
         ;
     return Ok<std::string>(0);
 }
+
+Result<PluginInputs, std::string> ModulePlugin::declare_inputs(const CMakeContext &ctx, bool) const
+{
+    return built_in_inputs(ctx);
+}
@@ -0,0 +1,457 @@
+#include "plugin/built-in/scanner.h"
+#include "plugin/built-in/utils.h"
+#include "toml/default/default.h"
+#include <deque>
+#include <thread>
+#include <functional>
+#include <fstream>
+#include <algorithm>
+#include <string_view>
+#include <condition_variable>
+
+/// A directory modified this recently may change again within the resolution of its timestamp.
+static constexpr auto RACY_WINDOW = std::chrono::seconds(2);
+
+/// @brief Match a glob: `**` matches across directories, `*`, `?` and `[...]` do not.
+static bool glob(std::string_view pattern, std::string_view text)
+{
+    if (pattern.empty())
+        return text.empty();
+    if (pattern.starts_with("**"))
+    {
+        auto rest = pattern.substr(2);
+        // `**/` also matches no directory at all.
+        if (rest.starts_with('/') && glob(rest.substr(1), text))
+            return true;
+        for (size_t i = 0; i <= text.size(); i++)
+            if (glob(rest, text.substr(i)))
+                return true;
+        return false;
+    }
+    if (pattern[0] == '*')
+    {
+        for (size_t i = 0; i <= text.size(); i++)
+        {
+            if (glob(pattern.substr(1), text.substr(i)))
+                return true;
+            if (i < text.size() && text[i] == '/')
+                break;
+        }
+        return false;
+    }
+    if (text.empty())
+        return false;
+    if (pattern[0] == '?')
+        return text[0] != '/' && glob(pattern.substr(1), text.substr(1));
+    if (pattern[0] == '[')
+    {
+        auto close = pattern.find(']', 2);
+        if (close != std::string_view::npos)
+        {
+            auto negate = pattern[1] == '!' || pattern[1] == '^';
+            auto matched = false;
+            for (size_t i = negate ? 2 : 1; i < close; i++)
+            {
+                if (i + 2 < close && pattern[i + 1] == '-')
+                {
+                    matched = matched || (pattern[i] <= text[0] && text[0] <= pattern[i + 2]);
+                    i += 2;
+                }
+                else
+                    matched = matched || pattern[i] == text[0];
+            }
+            return matched != negate && text[0] != '/' && glob(pattern.substr(close + 1), text.substr(1));
+        }
+    }
+    if (pattern[0] == '\\' && pattern.size() > 1)
+        pattern = pattern.substr(1);
+    return pattern[0] == text[0] && glob(pattern.substr(1), text.substr(1));
+}
+
+static void read_ignore_file(const fs::path &file, SourceScanner::Rules &rules)
+{
+    std::ifstream ifs(file);
+    std::string line;
+    while (std::getline(ifs, line))
+        SourceScanner::parse_rule(line, file.parent_path(), rules);
+}
+
+static fs::file_time_type::rep mtime_of(const fs::path &path)
+{
+    std::error_code ec;
+    auto time = fs::last_write_time(path, ec);
+    return ec ? 0 : time.time_since_epoch().count();
+}
+
+void SourceScanner::parse_rule(const std::string &line, const fs::path &base, Rules &rules)
+{
+    std::string pattern = line;
+    if (!pattern.empty() && pattern.back() == '\r')
+        pattern.pop_back();
+    while (!pattern.empty() && pattern.back() == ' ' && !pattern.ends_with("\\ "))
+        pattern.pop_back();
+    if (pattern.empty() || pattern[0] == '#')
+        return;
+    Rule rule;
+    rule.base = base.generic_string();
+    if (!rule.base.ends_with('/'))
+        rule.base += '/';
+    if (pattern[0] == '!')
+    {
+        rule.negate = true;
+        pattern.erase(0, 1);
+    }
+    if (pattern.ends_with('/'))
+    {
+        rule.dir_only = true;
+        pattern.pop_back();
+    }
+    rule.anchored = pattern.find('/') != std::string::npos;
+    if (pattern.starts_with('/'))
+        pattern.erase(0, 1);
+    if (pattern.empty())
+        return;
+    rule.pattern = pattern;
+    rules.push_back(rule);
+}
+
+bool SourceScanner::ignored(const Rules &rules, const fs::path &path, bool is_dir)
+{
+    auto result = false;
+    auto full = path.generic_string();
+    auto name = std::string_view(full).substr(full.rfind('/') + 1);
+    for (const auto &rule : rules)
+    {
+        if (rule.negate != result || (rule.dir_only && !is_dir))
+            continue;
+        if (rule.anchored)
+        {
+            if (full.size() > rule.base.size() && full.starts_with(rule.base) &&
+                glob(rule.pattern, std::string_view(full).substr(rule.base.size())))
+                result = !rule.negate;
+        }
+        else if (glob(rule.pattern, name))
+            result = !rule.negate;
+    }
+    return result;
+}
+
+bool SourceScanner::acquire_helper()
+{
+    static const unsigned limit = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+    auto count = this->helpers.load();
+    while (count < limit)
+        if (this->helpers.compare_exchange_weak(count, count + 1))
+            return true;
+    return false;
+}
+
+SourceScanner &SourceScanner::instance()
+{
+    static SourceScanner scanner;
+    return scanner;
+}
+
+/// @brief Get the ignore files which apply to a package, from the lowest precedence to the highest.
+/// @param top Set to the top directory of the work tree, or to `root` outside of a work tree.
+/// @note As with git, the `.gitignore` files of the parent directories apply up to the top of the
+///       work tree, along with `.git/info/exclude`. Outside of a work tree only the `.gitignore`
+///       of the package applies.
+static std::vector<fs::path> ignore_files_of(const fs::path &root, fs::path &top)
+{
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (auto dir = root; !dir.empty(); dir = dir.parent_path())
+    {
+        files.insert(files.begin(), dir / ".gitignore");
+        if (fs::exists(dir / ".git", ec))
+        {
+            files.insert(files.begin(), dir / ".git" / "info" / "exclude");
+            top = dir;
+            return files;
+        }
+        if (dir == dir.parent_path())
+            break;
+    }
+    top = root;
+    return {root / ".gitignore"};
+}
+
+std::shared_ptr<const SourceScanner::Rules> SourceScanner::rules_of(const fs::path &root)
+{
+    fs::path top;
+    auto files = ignore_files_of(root, top);
+    std::vector<fs::file_time_type::rep> stamps{mtime_of(root / "cup.toml")};
+    for (const auto &file : files)
+        stamps.push_back(mtime_of(file));
+    {
+        std::lock_guard lock(this->mutex);
+        auto iter = this->packages.find(root.string());
+        if (iter != this->packages.end() && iter->second.stamps == stamps)
+            return iter->second.rules;
+    }
+    auto rules = std::make_shared<Rules>();
+    for (size_t i = 0; i + 1 < files.size(); i++)
+        read_ignore_file(files[i], *rules);
+    // A package inside an ignored directory, such as a fetched dependency, is not part of the
+    // work tree, so the rules above it do not apply.
+    for (auto dir = root; !rules->empty() && dir != top && dir.has_relative_path(); dir = dir.parent_path())
+        if (ignored(*rules, dir, true))
+            rules->clear();
+    read_ignore_file(files.back(), *rules);
+    if (fs::exists(root / "cup.toml"))
+    {
+        auto config = data::parse_toml_file<data::Default>(root / "cup.toml");
+        if (config.build && config.build->exclude)
+            for (const auto &pattern : *config.build->exclude)
+                parse_rule(pattern, root, *rules);
+    }
+    std::lock_guard lock(this->mutex);
+    this->packages[root.string()] = PackageRules{stamps, rules};
+    return rules;
+}
+
+SourceScanner::ListingPtr SourceScanner::list(const fs::path &dir)
+{
+    auto time = fs::last_write_time(dir);
+    auto mtime = time.time_since_epoch().count();
+    {
+        std::lock_guard lock(this->mutex);
+        auto iter = this->listings.find(dir.string());
+        if (iter != this->listings.end() && iter->second->mtime == mtime)
+            return iter->second;
+    }
+    auto listing = std::make_shared<Listing>();
+    listing->mtime = mtime;
+    auto cacheable = fs::file_time_type::clock::now() - time > RACY_WINDOW &&
+                     dir.string().find('\n') == std::string::npos;
+    for (const auto &entry : fs::directory_iterator(dir))
+    {
+        auto name = entry.path().filename().string();
+        cacheable = cacheable && name.find('\n') == std::string::npos;
+        if (entry.is_directory())
+            listing->dirs.push_back(name);
+        else if (entry.is_regular_file())
+            listing->files.push_back(name);
+    }
+    if (cacheable)
+    {
+        std::lock_guard lock(this->mutex);
+        this->listings[dir.string()] = listing;
+        this->dirty = true;
+    }
+    return listing;
+}
+
+std::vector<fs::path> SourceScanner::scan(const fs::path &root, const fs::path &dir, bool recursive)
+{
+    struct Task
+    {
+        fs::path dir;
+        std::shared_ptr<const Rules> rules;
+    };
+    std::vector<fs::path> files;
+    if (!fs::is_directory(dir))
+        return files;
+
+    auto visit = [&](const Task &task, std::vector<fs::path> &found, std::vector<Task> &subdirs)
+    {
+        auto listing = this->list(task.dir);
+        auto rules = task.rules;
+        if (task.dir != root &&
+            std::find(listing->files.begin(), listing->files.end(), ".gitignore") != listing->files.end())
+        {
+            auto nested = std::make_shared<Rules>(*rules);
+            read_ignore_file(task.dir / ".gitignore", *nested);
+            rules = nested;
+        }
+        for (const auto &name : listing->files)
+        {
+            if (!is_source_file(name))
+                continue;
+            auto path = task.dir / name;
+            if (!ignored(*rules, path, false))
+                found.push_back(std::move(path));
+        }
+        if (!recursive)
+            return;
+        for (const auto &name : listing->dirs)
+        {
+            auto path = task.dir / name;
+            if (name != ".git" && !ignored(*rules, path, true))
+                subdirs.push_back(Task{path, rules});
+        }
+    };
+
+    std::deque<Task> queue{Task{dir, this->rules_of(root)}};
+    if (!recursive)
+    {
+        std::vector<Task> subdirs;
+        visit(queue.front(), files, subdirs);
+    }
+    else
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t busy = 0;
+        std::exception_ptr error;
+        std::vector<std::thread> threads;
+        std::function<void()> worker = [&]()
+        {
+            std::unique_lock lock(mutex);
+            while (true)
+            {
+                cv.wait(lock, [&]()
+                        { return !queue.empty() || busy == 0; });
+                if (queue.empty())
+                    return;
+                auto task = std::move(queue.front());
+                queue.pop_front();
+                busy++;
+                lock.unlock();
+                std::vector<fs::path> found;
+                std::vector<Task> subdirs;
+                std::exception_ptr failure;
+                try
+                {
+                    visit(task, found, subdirs);
+                }
+                catch (...)
+                {
+                    failure = std::current_exception();
+                }
+                lock.lock();
+                busy--;
+                if (failure)
+                {
+                    error = error ? error : failure;
+                    queue.clear();
+                }
+                else if (!error)
+                {
+                    files.insert(files.end(), found.begin(), found.end());
+                    for (auto &subdir : subdirs)
+                        queue.push_back(std::move(subdir));
+                    // A helper is only started for the directories this thread cannot take next,
+                    // and only while the threads of all the scans of the process are below the limit.
+                    if (queue.size() > 1 && this->acquire_helper())
+                        threads.emplace_back(worker);
+                }
+                cv.notify_all();
+            }
+        };
+        worker();
+        // No helper is started any more once the queue is drained.
+        for (auto &thread : threads)
+        {
+            thread.join();
+            this->helpers--;
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+    std::sort(files.begin(), files.end(), [](const fs::path &a, const fs::path &b)
+              { return a.native() < b.native(); });
+    return files;
+}
+
+std::vector<fs::path> SourceScanner::expand(const fs::path &root, const std::string &pattern)
+{
+    std::vector<fs::path> files;
+    // The walk starts at the deepest directory named without wildcards.
+    auto literal = pattern.substr(0, pattern.find_first_of("*?[\\"));
+    auto start = root / literal.substr(0, literal.rfind('/') + 1);
+    if (!fs::is_directory(start))
+        return files;
+    auto prefix = root.generic_string();
+    if (!prefix.ends_with('/'))
+        prefix += '/';
+    std::vector<fs::path> dirs{start};
+    while (!dirs.empty())
+    {
+        auto dir = std::move(dirs.back());
+        dirs.pop_back();
+        auto listing = this->list(dir);
+        for (const auto &name : listing->files)
+        {
+            auto path = dir / name;
+            auto full = path.generic_string();
+            if (full.starts_with(prefix) && glob(pattern, std::string_view(full).substr(prefix.size())))
+                files.push_back(std::move(path));
+        }
+        for (const auto &name : listing->dirs)
+            if (name != ".git")
+                dirs.push_back(dir / name);
+    }
+    std::sort(files.begin(), files.end(), [](const fs::path &a, const fs::path &b)
+              { return a.native() < b.native(); });
+    return files;
+}
+
+void SourceScanner::load(const fs::path &file)
+{
+    std::ifstream ifs(file);
+    if (!ifs.is_open())
+        return;
+    std::lock_guard lock(this->mutex);
+    std::string line;
+    std::shared_ptr<Listing> current;
+    while (std::getline(ifs, line))
+    {
+        if (line.size() < 2)
+            continue;
+        auto value = line.substr(2);
+        if (line[0] == 'D')
+        {
+            auto space = value.find(' ');
+            if (space == std::string::npos)
+            {
+                current = nullptr;
+                continue;
+            }
+            auto dir = value.substr(space + 1);
+            // Listings read in this process are newer than the cached ones.
+            if (this->listings.contains(dir))
+            {
+                current = nullptr;
+                continue;
+            }
+            fs::file_time_type::rep mtime{};
+            try
+            {
+                mtime = std::stoll(value.substr(0, space));
+            }
+            catch (const std::exception &)
+            {
+                current = nullptr;
+                continue;
+            }
+            current = std::make_shared<Listing>();
+            current->mtime = mtime;
+            this->listings[dir] = current;
+        }
+        else if (current && line[0] == 'f')
+            current->files.push_back(value);
+        else if (current && line[0] == 'd')
+            current->dirs.push_back(value);
+    }
+}
+
+void SourceScanner::save(const fs::path &file)
+{
+    std::lock_guard lock(this->mutex);
+    if (!this->dirty)
+        return;
+    if (!fs::exists(file.parent_path()))
+        fs::create_directories(file.parent_path());
+    std::ofstream ofs(file);
+    for (const auto &[dir, listing] : this->listings)
+    {
+        ofs << "D " << listing->mtime << " " << dir << "\n";
+        for (const auto &name : listing->files)
+            ofs << "f " << name << "\n";
+        for (const auto &name : listing->dirs)
+            ofs << "d " << name << "\n";
+    }
+    this->dirty = false;
+}
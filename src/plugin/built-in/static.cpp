@@ -4,59 +4,28 @@
 
 #include "plugin/built-in/static.h"
 #include "plugin/built-in/utils.h"
+#include "plugin/built-in/lean.h"
+#include "plugin/built-in/scanner.h"
 #include "template.h"
 #include "utils/utils.h"
 #include "toml/default/static.h"
 #include "res.h"
 #include <fstream>
-void StaticPlugin::_get_source_files(const fs::path &dir, std::vector<fs::path> &src_files) const
-{
-    for (const auto &entry : fs::directory_iterator(dir))
-    {
-        if (entry.is_directory())
-        {
-            _get_source_files(entry.path(), src_files);
-        }
-        else if (entry.is_regular_file() && is_source_file(entry.path()))
-        {
-            src_files.push_back(entry.path());
-        }
-    }
-}
-
 std::vector<fs::path> StaticPlugin::get_source_files(const fs::path &root) const
 {
     if (!fs::exists(root / "src"))
         throw std::runtime_error("Cannot find required directory 'src' in project root directory.");
-    std::vector<fs::path> source_files;
-    this->_get_source_files(root / "src", source_files);
-    return source_files;
+    return SourceScanner::instance().scan(root, root / "src");
 }
 
 std::vector<fs::path> StaticPlugin::get_test_mains(const fs::path &root) const
 {
-    if (!fs::exists(root / "tests"))
-        return std::vector<fs::path>();
-    std::vector<fs::path> test_mains;
-    for (const auto &entry : fs::directory_iterator(root / "tests"))
-    {
-        if (entry.is_regular_file() && is_source_file(entry.path()))
-            test_mains.push_back(entry.path());
-    }
-    return test_mains;
+    return SourceScanner::instance().scan(root, root / "tests", false);
 }
 
 std::vector<fs::path> StaticPlugin::get_example_mains(const fs::path &root) const
 {
-    if (!fs::exists(root / "examples"))
-        return std::vector<fs::path>();
-    std::vector<fs::path> example_mains;
-    for (const auto &entry : fs::directory_iterator(root / "examples"))
-    {
-        if (entry.is_regular_file() && is_source_file(entry.path()))
-            example_mains.push_back(entry.path());
-    }
-    return example_mains;
+    return SourceScanner::instance().scan(root, root / "examples", false);
 }
 Result<std::string, std::string> StaticPlugin::getName() const
 {
@@ -277,12 +246,16 @@ Result<std::string, std::string> StaticPlugin::gen_cmake(const CMakeContext &ctx
             replacements};
         for_examples.push_back(temp.getContent());
     }
-    return Ok<std::string>(FileTemplate{
+    auto sources = this->get_source_files(current_dir);
+    auto units = take_module_units(sources);
+    auto script = FileTemplate{
 #include "template/static/static.cmake"
         ,
         {
             {"FOR_GEN", join(for_gen, "\n")},
             {"FOR_MODE", join(for_mode, "\n")},
+            {"FOR_PUBLIC", gen_public(config.build)},
+            {"VISIBILITY", config.build && config.build->public_data ? "PRIVATE" : "PUBLIC"},
             {"FOR_TESTS", join(for_tests, "\n")},
             {"FOR_FEAT", join(for_feats, "\n")},
             {"FOR_TARGET", join(for_target, "\n")},
@@ -291,19 +264,22 @@ Result<std::string, std::string> StaticPlugin::gen_cmake(const CMakeContext &ctx
             {"IS_DEP", is_dependency ? "ON" : "OFF"},
             {"DEPS", join(deps, " ")},
             {"UNIQUE", name + "_" + replace(config.project.version, ".", "_")},
+            {"FOR_CONFIG", gen_config_header(config.build, root_dir, name + "_" + replace(config.project.version, ".", "_"))},
             {"TEST_MAIN_FILES", join(this->get_test_mains(current_dir), " ", dealpath)},
             {"TEST_OUT_DIR", dealpath(Resource::bin(root_dir) / "tests")},
             {"EXAMPLE_MAIN_FILES", join(this->get_example_mains(current_dir), " ", dealpath)},
             {"EXAMPLE_OUT_DIR", dealpath(Resource::bin(root_dir) / "examples")},
             {"INC", dealpath(current_dir / "include")},
-            {"EXPORT_INC", dealpath(current_dir / "export")},
-            {"SOURCES", join(this->get_source_files(current_dir), " ", dealpath)},
+            {"EXPORT_INC", dealpath(IncludeTree::public_dir(root_dir, current_dir, current_dir / "export"))},
+            {"SOURCES", join(sources, " ", dealpath)},
+            {"FOR_MODULES", gen_modules(name, units, current_dir / "src", name, false)},
             {"STDC", config.build && config.build->stdc ? std::to_string(*config.build->stdc) : ""},
             {"STDCXX", config.build && config.build->stdcxx ? std::to_string(*config.build->stdcxx) : ""},
             {"OUT_DIR", dealpath(Resource::lib(root_dir))},
         },
     }
-                               .getContent());
+                      .getContent();
+    return Ok<std::string>(lean_enabled(ctx) ? lean_cmake(script) : script);
 }
 
 Result<fs::path, std::string> StaticPlugin::run_project(const RunProjectData &data)
@@ -373,3 +349,8 @@ Result<int, std::string> StaticPlugin::show_help(const cmd::Args &command) const
         ;
     return Ok<std::string>(0);
 }
+
+Result<PluginInputs, std::string> StaticPlugin::declare_inputs(const CMakeContext &ctx, bool) const
+{
+    return built_in_inputs(ctx);
+}
@@ -0,0 +1,467 @@
+#include "plugin/host.h"
+#include "plugin/loader.h"
+#include "res.h"
+#include "log.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#ifdef __linux__
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/// The descriptor of the connection in the host process.
+static constexpr int HOST_FD = 3;
+/// Frames larger than this are treated as a corrupted stream.
+static constexpr uint32_t MAX_FRAME = 1u << 30;
+
+PluginHost::Frame &PluginHost::Frame::put(uint8_t value)
+{
+    this->data.push_back(static_cast<char>(value));
+    return *this;
+}
+
+PluginHost::Frame &PluginHost::Frame::put(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        this->data.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    return *this;
+}
+
+PluginHost::Frame &PluginHost::Frame::put(const std::string &value)
+{
+    this->put(static_cast<uint32_t>(value.size()));
+    this->data += value;
+    return *this;
+}
+
+PluginHost::Frame &PluginHost::Frame::put(const std::vector<std::string> &value)
+{
+    this->put(static_cast<uint32_t>(value.size()));
+    for (const auto &item : value)
+        this->put(item);
+    return *this;
+}
+
+PluginHost::Frame &PluginHost::Frame::put(const std::optional<std::string> &value)
+{
+    this->put(static_cast<uint8_t>(value.has_value()));
+    if (value)
+        this->put(*value);
+    return *this;
+}
+
+PluginHost::Frame &PluginHost::Frame::put(const CMakeContext &ctx)
+{
+    return this->put(ctx.name)
+        .put(static_cast<uint32_t>(ctx.cmake_version.first))
+        .put(static_cast<uint32_t>(ctx.cmake_version.second))
+        .put(ctx.current_dir.string())
+        .put(ctx.root_dir.string())
+        .put(ctx.features)
+        .put(std::vector<std::string>(ctx.dependencies.begin(), ctx.dependencies.end()));
+}
+
+PluginHost::Frame &PluginHost::Frame::put(const RunProjectData &data)
+{
+    return this->put(data.command)
+        .put(data.root.string())
+        .put(data.name)
+        .put(static_cast<uint8_t>(data.is_debug));
+}
+
+uint8_t PluginHost::Frame::get_u8()
+{
+    if (this->offset + 1 > this->data.size())
+        throw std::runtime_error("Truncated plugin host frame.");
+    return static_cast<uint8_t>(this->data[this->offset++]);
+}
+
+uint32_t PluginHost::Frame::get_u32()
+{
+    if (this->offset + 4 > this->data.size())
+        throw std::runtime_error("Truncated plugin host frame.");
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(this->data[this->offset++])) << (8 * i);
+    return value;
+}
+
+std::string PluginHost::Frame::get_string()
+{
+    auto size = this->get_u32();
+    if (this->offset + size > this->data.size())
+        throw std::runtime_error("Truncated plugin host frame.");
+    auto value = this->data.substr(this->offset, size);
+    this->offset += size;
+    return value;
+}
+
+std::vector<std::string> PluginHost::Frame::get_strings()
+{
+    auto count = this->get_u32();
+    std::vector<std::string> value;
+    for (uint32_t i = 0; i < count; i++)
+        value.push_back(this->get_string());
+    return value;
+}
+
+std::optional<std::string> PluginHost::Frame::get_optional()
+{
+    if (!this->get_u8())
+        return std::nullopt;
+    return this->get_string();
+}
+
+CMakeContext PluginHost::Frame::get_context()
+{
+    CMakeContext ctx;
+    ctx.name = this->get_string();
+    ctx.cmake_version.first = static_cast<int>(this->get_u32());
+    ctx.cmake_version.second = static_cast<int>(this->get_u32());
+    ctx.current_dir = this->get_string();
+    ctx.root_dir = this->get_string();
+    ctx.features = this->get_strings();
+    auto dependencies = this->get_strings();
+    ctx.dependencies = std::set<std::string>(dependencies.begin(), dependencies.end());
+    return ctx;
+}
+
+RunProjectData PluginHost::Frame::get_run_data()
+{
+    RunProjectData data;
+    data.command = this->get_optional();
+    data.root = this->get_string();
+    data.name = this->get_string();
+    data.is_debug = this->get_u8();
+    return data;
+}
+
+#ifdef __linux__
+static bool write_frame(int fd, const PluginHost::Frame &frame)
+{
+    std::string buffer;
+    auto size = static_cast<uint32_t>(frame.bytes().size());
+    for (int i = 0; i < 4; i++)
+        buffer.push_back(static_cast<char>((size >> (8 * i)) & 0xff));
+    buffer += frame.bytes();
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        auto n = send(fd, buffer.data() + written, buffer.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        written += n;
+    }
+    return true;
+}
+
+static bool read_exact(int fd, char *buffer, size_t size)
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        auto n = recv(fd, buffer + done, size - done, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+static std::optional<PluginHost::Frame> read_frame(int fd)
+{
+    unsigned char header[4];
+    if (!read_exact(fd, reinterpret_cast<char *>(header), sizeof(header)))
+        return std::nullopt;
+    uint32_t size = header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<uint32_t>(header[3]) << 24);
+    if (size > MAX_FRAME)
+        return std::nullopt;
+    std::string data(size, '\0');
+    if (!read_exact(fd, data.data(), size))
+        return std::nullopt;
+    return PluginHost::Frame(std::move(data));
+}
+#endif
+
+PluginHost::PluginHost(const std::string &type) : type(type)
+{
+#ifdef __linux__
+    auto exe = Resource::executable().string();
+    if (exe.empty())
+        throw std::runtime_error("Cannot identify the cup executable to host plugin '" + type + "'.");
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        throw std::runtime_error("Failed to connect to the host of plugin '" + type + "'.");
+    std::fflush(stdout);
+    std::cout.flush();
+    auto pid = fork();
+    if (pid == 0)
+    {
+        // Only the end of the host survives `exec`, as a fixed descriptor.
+        if (fds[1] == HOST_FD)
+            fcntl(HOST_FD, F_SETFD, 0);
+        else
+            dup2(fds[1], HOST_FD);
+        execl(exe.c_str(), exe.c_str(), "plugin-host", type.c_str(), "3", static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    close(fds[1]);
+    if (pid == -1)
+    {
+        close(fds[0]);
+        throw std::runtime_error("Failed to start the host of plugin '" + type + "'.");
+    }
+    this->pid = pid;
+    this->fd = fds[0];
+    try
+    {
+        auto hello = read_frame(this->fd);
+        if (!hello)
+            throw std::runtime_error("The host of plugin '" + type + "' exited while starting.");
+        if (!hello->get_u8())
+            throw std::runtime_error(hello->get_string());
+        this->cacheable_ = hello->get_u8();
+    }
+    catch (...)
+    {
+        // The destructor does not run for a host which failed to start.
+        close(this->fd);
+        kill(this->pid, SIGKILL);
+        waitpid(this->pid, nullptr, 0);
+        throw;
+    }
+#else
+    throw std::runtime_error("Plugin hosts are not supported on this platform.");
+#endif
+}
+
+PluginHost::~PluginHost()
+{
+#ifdef __linux__
+    // The host exits when the connection is closed.
+    if (this->fd != -1)
+        close(this->fd);
+    if (this->pid != -1)
+        waitpid(this->pid, nullptr, 0);
+#endif
+}
+
+PluginHost::Frame PluginHost::call(const Frame &request) const
+{
+#ifdef __linux__
+    if (this->broken)
+        throw std::runtime_error("The host of plugin '" + this->type + "' is not running.");
+    std::optional<Frame> response;
+    if (write_frame(this->fd, request))
+        response = read_frame(this->fd);
+    if (!response)
+    {
+        this->broken = true;
+        int status = 0;
+        if (waitpid(this->pid, &status, 0) == this->pid && WIFSIGNALED(status))
+        {
+            const_cast<PluginHost *>(this)->pid = -1;
+            throw std::runtime_error("Plugin '" + this->type + "' crashed with signal " +
+                                     std::to_string(WTERMSIG(status)) + ".");
+        }
+        const_cast<PluginHost *>(this)->pid = -1;
+        throw std::runtime_error("The host of plugin '" + this->type + "' exited unexpectedly.");
+    }
+    return *response;
+#else
+    throw std::runtime_error("Plugin hosts are not supported on this platform.");
+#endif
+}
+
+Result<std::string, std::string> PluginHost::getName() const
+{
+    return Ok<std::string>(this->type);
+}
+
+Result<int, std::string> PluginHost::run_new(const NewData &)
+{
+    return Err<int>(std::string("Creating projects is not supported by the plugin host."));
+}
+
+Result<std::string, std::string> PluginHost::gen_cmake(const CMakeContext &ctx, bool is_dependency)
+{
+    auto response = this->call(Frame().put(static_cast<uint8_t>(Op::GenCMake)).put(ctx).put(static_cast<uint8_t>(is_dependency)));
+    if (!response.get_u8())
+        return Err<std::string>(response.get_string());
+    return Ok<std::string>(response.get_string());
+}
+
+Result<std::string, std::string> PluginHost::gen_cmake_global(const CMakeContext &ctx, bool is_dependency)
+{
+    auto response = this->call(Frame().put(static_cast<uint8_t>(Op::GenCMakeGlobal)).put(ctx).put(static_cast<uint8_t>(is_dependency)));
+    if (!response.get_u8())
+        return Err<std::string>(response.get_string());
+    return Ok<std::string>(response.get_string());
+}
+
+Result<fs::path, std::string> PluginHost::run_project(const RunProjectData &data)
+{
+    auto response = this->call(Frame().put(static_cast<uint8_t>(Op::RunProject)).put(data));
+    if (!response.get_u8())
+        return Err<fs::path>(response.get_string());
+    return Ok<std::string>(fs::path(response.get_string()));
+}
+
+Result<std::optional<std::string>, std::string> PluginHost::get_target(const RunProjectData &data) const
+{
+    auto response = this->call(Frame().put(static_cast<uint8_t>(Op::GetTarget)).put(data));
+    if (!response.get_u8())
+        return Err<std::optional<std::string>>(response.get_string());
+    return Ok<std::string>(response.get_optional());
+}
+
+Result<int, std::string> PluginHost::show_help(const cmd::Args &) const
+{
+    return Err<int>(std::string("Showing help is not supported by the plugin host."));
+}
+
+Result<PluginInputs, std::string> PluginHost::declare_inputs(const CMakeContext &ctx, bool is_dependency) const
+{
+    auto response = this->call(Frame().put(static_cast<uint8_t>(Op::DeclareInputs)).put(ctx).put(static_cast<uint8_t>(is_dependency)));
+    if (!response.get_u8())
+        return Err<PluginInputs>(response.get_string());
+    PluginInputs inputs;
+    for (const auto &file : response.get_strings())
+        inputs.files.push_back(file);
+    inputs.globs = response.get_strings();
+    inputs.env = response.get_strings();
+    inputs.version = response.get_string();
+    inputs.cache_key = response.get_optional();
+    return Ok<std::string>(inputs);
+}
+
+/// @brief Answer a request with the plugin loaded in this process.
+static PluginHost::Frame handle(PluginLoader &plugin, PluginHost::Frame &request)
+{
+    using Op = PluginHost::Op;
+    PluginHost::Frame response;
+    auto op = static_cast<Op>(request.get_u8());
+    switch (op)
+    {
+    case Op::GenCMake:
+    case Op::GenCMakeGlobal:
+    {
+        auto ctx = request.get_context();
+        bool is_dependency = request.get_u8();
+        auto result = op == Op::GenCMake ? plugin->gen_cmake(ctx, is_dependency)
+                                         : plugin->gen_cmake_global(ctx, is_dependency);
+        if (result.is_error())
+            return response.put(static_cast<uint8_t>(0)).put(result.error());
+        return response.put(static_cast<uint8_t>(1)).put(result.ok());
+    }
+    case Op::GetTarget:
+    {
+        auto result = plugin->get_target(request.get_run_data());
+        if (result.is_error())
+            return response.put(static_cast<uint8_t>(0)).put(result.error());
+        return response.put(static_cast<uint8_t>(1)).put(result.ok());
+    }
+    case Op::RunProject:
+    {
+        auto result = plugin->run_project(request.get_run_data());
+        if (result.is_error())
+            return response.put(static_cast<uint8_t>(0)).put(result.error());
+        return response.put(static_cast<uint8_t>(1)).put(result.ok().string());
+    }
+    case Op::DeclareInputs:
+    {
+        auto ctx = request.get_context();
+        bool is_dependency = request.get_u8();
+        if (!plugin.cacheable())
+            return response.put(static_cast<uint8_t>(0)).put(std::string("The plugin does not declare its inputs."));
+        auto result = plugin.cacheable()->declare_inputs(ctx, is_dependency);
+        if (result.is_error())
+            return response.put(static_cast<uint8_t>(0)).put(result.error());
+        const auto &inputs = result.ok();
+        std::vector<std::string> files;
+        for (const auto &file : inputs.files)
+            files.push_back(file.string());
+        return response.put(static_cast<uint8_t>(1))
+            .put(files)
+            .put(inputs.globs)
+            .put(inputs.env)
+            .put(inputs.version)
+            .put(inputs.cache_key);
+    }
+    }
+    return response.put(static_cast<uint8_t>(0)).put("Unknown request " + std::to_string(static_cast<int>(op)) + ".");
+}
+
+int PluginHost::serve(const std::string &type, int fd)
+{
+#ifdef __linux__
+    std::optional<PluginLoader> plugin;
+    try
+    {
+        plugin.emplace(type);
+    }
+    catch (const std::exception &e)
+    {
+        write_frame(fd, Frame().put(static_cast<uint8_t>(0)).put(std::string(e.what())));
+        return 1;
+    }
+    if (!write_frame(fd, Frame().put(static_cast<uint8_t>(1)).put(static_cast<uint8_t>(plugin->cacheable() != nullptr))))
+        return 1;
+    while (auto request = read_frame(fd))
+    {
+        Frame response;
+        try
+        {
+            response = handle(*plugin, *request);
+        }
+        catch (const std::exception &e)
+        {
+            response = Frame().put(static_cast<uint8_t>(0)).put(std::string(e.what()));
+        }
+        std::fflush(stdout);
+        std::cout.flush();
+        if (!write_frame(fd, response))
+            return 1;
+    }
+    return 0;
+#else
+    throw std::runtime_error("Plugin hosts are not supported on this platform.");
+#endif
+}
+
+PluginHostPool &PluginHostPool::instance()
+{
+    static PluginHostPool pool;
+    return pool;
+}
+
+std::unique_ptr<PluginHost> PluginHostPool::acquire(const std::string &type)
+{
+    {
+        std::lock_guard lock(this->mutex);
+        auto &hosts = this->idle[type];
+        if (!hosts.empty())
+        {
+            auto host = std::move(hosts.back());
+            hosts.pop_back();
+            return host;
+        }
+    }
+    return std::make_unique<PluginHost>(type);
+}
+
+void PluginHostPool::release(std::unique_ptr<PluginHost> host)
+{
+    if (!host || !host->alive())
+        return;
+    std::lock_guard lock(this->mutex);
+    this->idle[host->plugin_type()].push_back(std::move(host));
+}
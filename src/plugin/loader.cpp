@@ -2,6 +2,7 @@
 #include <unordered_map>
 #include <functional>
 #include <stdexcept>
+#include <chrono>
 #include "plugin/loader.h"
 #include "plugin/built-in/binary.h"
 #include "plugin/built-in/shared.h"
@@ -9,10 +10,11 @@
 #include "plugin/built-in/module.h"
 #include "plugin/built-in/interface.h"
 #include "res.h"
+#include "fingerprint.h"
 
-PluginLoader::PluginLoader(const std::string &type)
+static const std::unordered_map<std::string, std::function<IPlugin *()>> &built_in_plugins()
 {
-    std::unordered_map<std::string, std::function<IPlugin *()>> built_in_plugins = {
+    static const std::unordered_map<std::string, std::function<IPlugin *()>> plugins = {
         {
             "binary",
             []
@@ -39,7 +41,25 @@ PluginLoader::PluginLoader(const std::string &type)
             { return new InterfacePlugin(); },
         },
     };
-    if (!built_in_plugins.contains(type))
+    return plugins;
+}
+
+bool PluginLoader::is_built_in(const std::string &type)
+{
+    return built_in_plugins().contains(type);
+}
+
+PluginRegistry &PluginRegistry::instance()
+{
+    static PluginRegistry registry;
+    return registry;
+}
+
+PluginRegistry::Entry PluginRegistry::load(const std::string &type)
+{
+    auto start = std::chrono::steady_clock::now();
+    Entry entry;
+    if (!PluginLoader::is_built_in(type))
     {
         auto path = (Resource::cup() / "plugins" /
                      (type +
@@ -50,34 +70,121 @@ PluginLoader::PluginLoader(const std::string &type)
 #endif
                       ))
                         .lexically_normal();
-        try
-        {
-            if (!fs::exists(path))
-                throw std::runtime_error("Plugin '" + type + "' not installed.");
-            if (!DLL_LOAD(this->dll, path.string()))
-                throw std::runtime_error("Plugin '" + type + "' failed to load.");
-            if (!DLL_GET_FUNC(this->dll, createPlugin) || !DLL_GET_FUNC(this->dll, destroyPlugin))
-                throw std::runtime_error("Plugin '" + type + "' not a valid plugin.");
-        }
-        catch (const std::exception &e)
+        CreatePluginFunc createPlugin{nullptr};
+        DestroyPluginFunc destroyPlugin{nullptr};
+        if (!fs::exists(path))
+            throw std::runtime_error("Plugin '" + type + "' not installed.");
+        if (!DLL_LOAD(entry.dll, path.string()))
+            throw std::runtime_error("Plugin '" + type + "' failed to load.");
+        if (!DLL_GET_FUNC(entry.dll, createPlugin) || !DLL_GET_FUNC(entry.dll, destroyPlugin))
         {
-            DLL_UNLOAD(this->dll);
-            throw e;
+            DLL_UNLOAD(entry.dll);
+            throw std::runtime_error("Plugin '" + type + "' not a valid plugin.");
         }
-        this->plugin = this->createPlugin();
+        entry.plugin = createPlugin();
+        entry.destroyPlugin = destroyPlugin;
+        CacheablePluginFunc cacheablePlugin{nullptr};
+        if (DLL_GET_FUNC(entry.dll, cacheablePlugin))
+            entry.cacheable = cacheablePlugin(entry.plugin);
+        ThreadSafePluginFunc threadSafePlugin{nullptr};
+        if (!DLL_GET_FUNC(entry.dll, threadSafePlugin) || !threadSafePlugin())
+            entry.lock = std::make_shared<std::mutex>();
     }
     else
     {
-        this->plugin = built_in_plugins[type]();
-        this->dll = nullptr;
-        this->destroyPlugin = [](IPlugin *plugin)
+        entry.plugin = built_in_plugins().at(type)();
+        entry.destroyPlugin = [](IPlugin *plugin)
         { delete plugin; };
+        entry.cacheable = dynamic_cast<ICacheable *>(entry.plugin);
+        // The built-in plugins keep no state between calls.
+    }
+    entry.load_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return entry;
+}
+
+PluginRegistry::~PluginRegistry()
+{
+    for (auto iter = this->order.rbegin(); iter != this->order.rend(); ++iter)
+    {
+        auto &entry = this->plugins.at(*iter);
+        entry.destroyPlugin(entry.plugin);
+        if (entry.dll)
+            DLL_UNLOAD(entry.dll);
+    }
+}
+
+IPlugin *PluginRegistry::get(const std::string &type)
+{
+    std::lock_guard lock(this->mutex);
+    auto iter = this->plugins.find(type);
+    if (iter == this->plugins.end())
+    {
+        iter = this->plugins.emplace(type, this->load(type)).first;
+        this->order.push_back(type);
+    }
+    return iter->second.plugin;
+}
+
+ICacheable *PluginRegistry::cacheable(const std::string &type)
+{
+    this->get(type);
+    std::lock_guard lock(this->mutex);
+    return this->plugins.at(type).cacheable;
+}
+
+std::shared_ptr<std::mutex> PluginRegistry::lock_of(const std::string &type)
+{
+    this->get(type);
+    std::lock_guard lock(this->mutex);
+    return this->plugins.at(type).lock;
+}
+
+std::vector<std::pair<std::string, double>> PluginRegistry::load_times()
+{
+    std::lock_guard lock(this->mutex);
+    std::vector<std::pair<std::string, double>> result;
+    for (const auto &type : this->order)
+        result.emplace_back(type, this->plugins.at(type).load_time);
+    return result;
+}
+
+PluginLoader::PluginLoader(const std::string &type, bool isolate)
+{
+    // Each host serves one request at a time, so hosted plugins need no lock.
+    if (isolate && !is_built_in(type))
+    {
+        this->host = PluginHostPool::instance().acquire(type);
+        this->plugin = this->host.get();
+        this->extension = this->host->cacheable() ? this->host.get() : nullptr;
+        return;
     }
+    this->plugin = PluginRegistry::instance().get(type);
+    this->extension = PluginRegistry::instance().cacheable(type);
+    this->lock = PluginRegistry::instance().lock_of(type);
 }
 
 PluginLoader::~PluginLoader()
 {
-    this->destroyPlugin(this->plugin);
-    if (this->dll)
-        DLL_UNLOAD(this->dll);
-}
\ No newline at end of file
+    if (this->host)
+        PluginHostPool::instance().release(std::move(this->host));
+}
+
+std::optional<std::string> PluginLoader::built_in_version()
+{
+    static auto version = []() -> std::optional<std::string>
+    {
+        std::error_code ec;
+        auto path = Resource::executable();
+        if (path.empty())
+            return std::nullopt;
+        auto size = fs::file_size(path, ec);
+        if (ec)
+            return std::nullopt;
+        auto time = fs::last_write_time(path, ec);
+        if (ec)
+            return std::nullopt;
+        return Fingerprint::hash(path.string() + "\n" + std::to_string(size) + "\n" +
+                                 std::to_string(time.time_since_epoch().count()));
+    }();
+    return version;
+}
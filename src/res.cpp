@@ -3,6 +3,12 @@
 #include "utils/utils.h"
 #include "cmd/git.h"
 #include "log.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
 
 fs::path Resource::home()
 {
@@ -44,6 +50,18 @@ fs::path Resource::packages()
     return packages;
 }
 
+fs::path Resource::toolchains()
+{
+    static auto toolchains = cup() / "toolchains";
+    return toolchains;
+}
+
+fs::path Resource::workers()
+{
+    static auto workers = cup() / "workers";
+    return workers;
+}
+
 std::string Resource::read_cache(const std::string &file_name)
 {
     std::string result;
@@ -57,6 +75,26 @@ std::string Resource::read_cache(const std::string &file_name)
     return result;
 }
 
+fs::path Resource::executable()
+{
+    static auto executable = []() -> fs::path
+    {
+        std::error_code ec;
+#ifdef _WIN32
+        wchar_t buffer[MAX_PATH];
+        auto size = GetModuleFileNameW(nullptr, buffer, MAX_PATH);
+        return size > 0 && size < MAX_PATH ? fs::path(buffer) : fs::path();
+#elif defined(__APPLE__)
+        char buffer[4096];
+        uint32_t size = sizeof(buffer);
+        return _NSGetExecutablePath(buffer, &size) == 0 ? fs::canonical(buffer, ec) : fs::path();
+#else
+        return fs::read_symlink("/proc/self/exe", ec);
+#endif
+    }();
+    return executable;
+}
+
 fs::path Resource::target(const fs::path &root)
 {
     return root / "target";
@@ -92,6 +130,11 @@ fs::path Resource::build(const fs::path &root)
     return target(root) / "build";
 }
 
+fs::path Resource::socket(const fs::path &root)
+{
+    return target(root) / "cup.sock";
+}
+
 std::pair<fs::path, std::string> Resource::repo_dir(const std::string &url,
                                                     const std::optional<std::string> &version, bool download)
 {
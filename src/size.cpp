@@ -0,0 +1,903 @@
+#include "size.h"
+#include "res.h"
+#include "log.h"
+#include "toml/default/default.h"
+#include "utils/utils.h"
+#include <map>
+#include <set>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+
+namespace
+{
+    /// The values of the ELF format which matter to the size of a file.
+    namespace elf
+    {
+        constexpr uint32_t SYMTAB = 2;
+        constexpr uint32_t NOBITS = 8;
+        constexpr uint32_t DYNSYM = 11;
+        constexpr uint64_t WRITE = 1;
+        constexpr uint64_t ALLOC = 2;
+        constexpr uint8_t OBJECT = 1;
+        constexpr uint8_t FUNC = 2;
+        constexpr uint8_t FILE = 4;
+        constexpr uint8_t TLS = 6;
+        constexpr uint8_t LOCAL = 0;
+        constexpr uint64_t UNDEF = 0;
+        constexpr uint64_t LORESERVE = 0xff00;
+    }
+
+    /// @brief Read the integers of an ELF file in its byte order.
+    struct Bytes
+    {
+        std::string_view data;
+        bool big_endian{false};
+
+        uint64_t get(uint64_t offset, size_t width) const
+        {
+            if (offset > this->data.size() || width > this->data.size() - offset)
+                throw std::out_of_range("The file is truncated.");
+            uint64_t value = 0;
+            for (size_t i = 0; i < width; i++)
+            {
+                auto byte = static_cast<uint64_t>(static_cast<unsigned char>(this->data[offset + i]));
+                value |= byte << (8 * (this->big_endian ? width - 1 - i : i));
+            }
+            return value;
+        }
+
+        /// @brief Get a string of a string table.
+        std::string str(uint64_t table, uint64_t table_size, uint64_t offset) const
+        {
+            if (offset >= table_size || table > this->data.size() || table_size > this->data.size() - table)
+                return "";
+            auto value = this->data.substr(table + offset, table_size - offset);
+            return std::string(value.substr(0, value.find('\0')));
+        }
+    };
+
+    struct Section
+    {
+        std::string name;
+        uint64_t size{0};
+        bool alloc{false};
+        bool write{false};
+        bool nobits{false};
+    };
+
+    struct Symbol
+    {
+        std::string name;
+        uint64_t address{0};
+        uint64_t size{0};
+        uint64_t section{0};
+        bool local{false};
+        /// The source file of a local symbol, or the member of an archive.
+        std::string file;
+    };
+
+    /// @brief The tables of an ELF file, or of all members of an archive.
+    struct Image
+    {
+        std::vector<Section> sections;
+        std::vector<Symbol> symbols;
+        /// Only the dynamic symbols are left.
+        bool stripped{false};
+        /// The number of symbols the file defines in its dynamic symbol table, if it has one.
+        std::optional<uint64_t> exported;
+    };
+
+    std::optional<Image> read_elf(std::string_view data)
+    {
+        if (data.size() < 52 || data.substr(0, 4) != "\x7f"
+                                                     "ELF")
+            return std::nullopt;
+        auto is64 = data[4] == 2;
+        Bytes bytes{data, data[5] == 2};
+        struct Header
+        {
+            uint64_t name, type, flags, offset, size, link, entsize;
+        };
+        try
+        {
+            auto shoff = is64 ? bytes.get(0x28, 8) : bytes.get(0x20, 4);
+            auto shentsize = bytes.get(is64 ? 0x3a : 0x2e, 2);
+            auto shnum = bytes.get(is64 ? 0x3c : 0x30, 2);
+            auto shstrndx = bytes.get(is64 ? 0x3e : 0x32, 2);
+            Image image;
+            if (shoff == 0)
+                return image;
+            auto header = [&](uint64_t i)
+            {
+                auto base = shoff + i * shentsize;
+                if (is64)
+                    return Header{bytes.get(base, 4), bytes.get(base + 4, 4), bytes.get(base + 8, 8),
+                                  bytes.get(base + 24, 8), bytes.get(base + 32, 8), bytes.get(base + 40, 4),
+                                  bytes.get(base + 56, 8)};
+                return Header{bytes.get(base, 4), bytes.get(base + 4, 4), bytes.get(base + 8, 4),
+                              bytes.get(base + 16, 4), bytes.get(base + 20, 4), bytes.get(base + 24, 4),
+                              bytes.get(base + 36, 4)};
+            };
+            // Files with many sections keep the real counts in the first section header.
+            if (shnum == 0)
+                shnum = header(0).size;
+            if (shstrndx == 0xffff)
+                shstrndx = header(0).link;
+            if (shnum > data.size() / std::max<uint64_t>(shentsize, 1))
+                return std::nullopt;
+            std::vector<Header> headers;
+            for (uint64_t i = 0; i < shnum; i++)
+                headers.push_back(header(i));
+
+            const auto &names = headers.at(shstrndx);
+            for (const auto &h : headers)
+                image.sections.push_back(Section{
+                    .name = bytes.str(names.offset, names.size, h.name),
+                    .size = h.size,
+                    .alloc = (h.flags & elf::ALLOC) != 0,
+                    .write = (h.flags & elf::WRITE) != 0,
+                    .nobits = h.type == elf::NOBITS,
+                });
+
+            // The symbols exported by a shared library, which `[build] visibility` reduces.
+            for (const auto &h : headers)
+            {
+                if (h.type != elf::DYNSYM)
+                    continue;
+                auto entsize = h.entsize ? h.entsize : (is64 ? 24 : 16);
+                uint64_t count = 0;
+                for (uint64_t i = 1; i < h.size / entsize; i++)
+                {
+                    auto base = h.offset + i * entsize;
+                    auto info = bytes.get(base + (is64 ? 4 : 12), 1);
+                    auto shndx = bytes.get(base + (is64 ? 6 : 14), 2);
+                    if (shndx != elf::UNDEF && (info >> 4) != elf::LOCAL)
+                        count++;
+                }
+                image.exported = count;
+            }
+
+            // The full symbol table when the file is not stripped, the dynamic one otherwise.
+            auto table = std::find_if(headers.begin(), headers.end(),
+                                      [](const Header &h) { return h.type == elf::SYMTAB; });
+            if (table == headers.end())
+                table = std::find_if(headers.begin(), headers.end(),
+                                     [](const Header &h) { return h.type == elf::DYNSYM; });
+            image.stripped = table == headers.end() || table->type == elf::DYNSYM;
+            if (table == headers.end())
+                return image;
+            const auto &strings = headers.at(table->link);
+            auto entsize = table->entsize ? table->entsize : (is64 ? 24 : 16);
+            std::string file;
+            std::set<std::pair<uint64_t, uint64_t>> seen;
+            for (uint64_t i = 1; i < table->size / entsize; i++)
+            {
+                auto base = table->offset + i * entsize;
+                uint64_t name, info, shndx, value, size;
+                if (is64)
+                {
+                    name = bytes.get(base, 4);
+                    info = bytes.get(base + 4, 1);
+                    shndx = bytes.get(base + 6, 2);
+                    value = bytes.get(base + 8, 8);
+                    size = bytes.get(base + 16, 8);
+                }
+                else
+                {
+                    name = bytes.get(base, 4);
+                    value = bytes.get(base + 4, 4);
+                    size = bytes.get(base + 8, 4);
+                    info = bytes.get(base + 12, 1);
+                    shndx = bytes.get(base + 14, 2);
+                }
+                auto type = static_cast<uint8_t>(info & 0xf);
+                auto local = (info >> 4) == elf::LOCAL;
+                // The local symbols of each object follow the name of its source file.
+                if (type == elf::FILE)
+                {
+                    file = bytes.str(strings.offset, strings.size, name);
+                    continue;
+                }
+                if (shndx == elf::UNDEF || shndx >= elf::LORESERVE || size == 0)
+                    continue;
+                if (type != elf::OBJECT && type != elf::FUNC && type != elf::TLS)
+                    continue;
+                // Aliases, such as the complete and base object constructors, share their bytes.
+                if (!seen.emplace(shndx, value).second)
+                    continue;
+                image.symbols.push_back(Symbol{
+                    .name = bytes.str(strings.offset, strings.size, name),
+                    .address = value,
+                    .size = size,
+                    .section = shndx,
+                    .local = local,
+                    .file = local ? fs::path(file).filename().string() : "",
+                });
+            }
+            return image;
+        }
+        catch (const std::out_of_range &)
+        {
+            return std::nullopt;
+        }
+    }
+
+    /// @brief Split an `ar` archive into its members.
+    /// @return The name and the content of each member, in order.
+    std::vector<std::pair<std::string, std::string_view>> read_archive(std::string_view data)
+    {
+        std::vector<std::pair<std::string, std::string_view>> members;
+        if (!data.starts_with("!<arch>\n"))
+            return members;
+        std::string_view long_names;
+        size_t offset = 8;
+        while (offset + 60 <= data.size())
+        {
+            auto header = data.substr(offset, 60);
+            auto name = header.substr(0, 16);
+            name = name.substr(0, name.find_last_not_of(' ') + 1);
+            auto size = std::strtoull(std::string(header.substr(48, 10)).c_str(), nullptr, 10);
+            offset += 60;
+            if (size > data.size() - offset)
+                break;
+            auto body = data.substr(offset, size);
+            offset += size + (size & 1);
+            // The symbol index of the linkers.
+            if (name == "/" || name == "/SYM64/" || name.starts_with("__.SYMDEF"))
+                continue;
+            if (name == "//")
+            {
+                long_names = body;
+                continue;
+            }
+            if (name.starts_with("#1/"))
+            {
+                // BSD archives write long names in front of the member.
+                auto length = std::strtoull(std::string(name.substr(3)).c_str(), nullptr, 10);
+                if (length > body.size())
+                    break;
+                name = body.substr(0, length);
+                name = name.substr(0, name.find('\0'));
+                body = body.substr(length);
+            }
+            else if (name.size() > 1 && name[0] == '/' && std::isdigit(static_cast<unsigned char>(name[1])))
+            {
+                auto at = std::strtoull(std::string(name.substr(1)).c_str(), nullptr, 10);
+                name = at < long_names.size() ? long_names.substr(at) : std::string_view{};
+                name = name.substr(0, name.find_first_of("/\n"));
+            }
+            else if (name.ends_with('/'))
+                name.remove_suffix(1);
+            members.emplace_back(std::string(name), body);
+        }
+        return members;
+    }
+
+    /// @brief Read an executable, a shared library or a static library.
+    std::optional<Image> read_image(const std::string &data)
+    {
+        if (!data.starts_with("!<arch>\n"))
+            return read_elf(data);
+        // Sections of the members are summed by name, their symbols are kept with their member.
+        Image image;
+        std::map<std::string, size_t> sections;
+        for (const auto &[member, body] : read_archive(data))
+        {
+            auto object = read_elf(body);
+            if (!object)
+                continue;
+            image.stripped = image.stripped || object->stripped;
+            for (auto section : object->sections)
+            {
+                // Functions and data may have sections of their own, such as `.text._Z3foov`.
+                for (const auto &prefix : {".text", ".rodata", ".data.rel.ro", ".data", ".bss", ".tdata", ".tbss"})
+                    if (section.name == prefix)
+                        break;
+                    else if (section.name.starts_with(std::string(prefix) + "."))
+                    {
+                        section.name = prefix;
+                        break;
+                    }
+                auto [iter, inserted] = sections.emplace(section.name, image.sections.size());
+                if (inserted)
+                    image.sections.push_back(section);
+                else
+                    image.sections[iter->second].size += section.size;
+            }
+            // Sections of different members are told apart by the member.
+            for (auto &symbol : object->symbols)
+            {
+                symbol.file = member;
+                image.symbols.push_back(std::move(symbol));
+            }
+        }
+        if (image.sections.empty())
+            return std::nullopt;
+        return image;
+    }
+
+    std::string demangle(const std::string &name)
+    {
+#if __has_include(<cxxabi.h>)
+        int status = 0;
+        char *result = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+        if (status == 0 && result)
+        {
+            std::string demangled = result;
+            std::free(result);
+            return demangled;
+        }
+        std::free(result);
+#endif
+        return name;
+    }
+
+    /// @brief Get the template a symbol is an instantiation of, with the arguments and the function
+    ///        parameters removed, such as `std::vector<>::push_back` for
+    ///        `std::vector<int, std::allocator<int> >::push_back(int const&)`.
+    /// @return Nothing if the symbol is not in a template.
+    std::optional<std::string> template_of(const std::string &name)
+    {
+        static constexpr std::string_view OPERATOR = "operator";
+        static constexpr std::string_view ANONYMOUS = "(anonymous namespace)";
+        static constexpr std::string_view OPERATOR_CHARS = "<>=!+-*/%^&|~,[]";
+        std::string result;
+        int depth = 0;
+        int braces = 0;
+        auto templated = false;
+        for (size_t i = 0; i < name.size(); i++)
+        {
+            auto c = name[i];
+            if (depth == 0 && braces == 0 && name.compare(i, OPERATOR.size(), OPERATOR) == 0)
+            {
+                // The brackets of `operator<` and `operator()` are part of the name.
+                auto end = i + OPERATOR.size();
+                if (name.compare(end, 2, "()") == 0)
+                    end += 2;
+                else
+                    while (end < name.size() && OPERATOR_CHARS.find(name[end]) != std::string_view::npos)
+                        end++;
+                result += name.substr(i, end - i);
+                if (end < name.size() && name[end] == ' ' && end > i + OPERATOR.size())
+                    end++;
+                i = end - 1;
+                continue;
+            }
+            if (depth == 0 && braces == 0 && name.compare(i, ANONYMOUS.size(), ANONYMOUS) == 0)
+            {
+                result += ANONYMOUS;
+                i += ANONYMOUS.size() - 1;
+                continue;
+            }
+            if (c == '{')
+                braces++;
+            else if (c == '}')
+                braces -= braces > 0;
+            if (braces > 0 || c == '}')
+            {
+                if (depth == 0)
+                    result.push_back(c);
+                continue;
+            }
+            if (c == '<')
+            {
+                if (depth++ == 0)
+                    result += "<>";
+                templated = true;
+            }
+            else if (c == '>')
+                depth -= depth > 0;
+            else if (depth > 0)
+                continue;
+            // The parameters of the function.
+            else if (c == '(')
+                break;
+            // The return type of a function template, or `vtable for` and the like.
+            else if (c == ' ' && !result.ends_with(OPERATOR))
+                result.clear();
+            else
+                result.push_back(c);
+        }
+        if (!templated || result.find("<>") == std::string::npos)
+            return std::nullopt;
+        return result;
+    }
+
+    /// @brief Get the outermost namespace or class of a demangled name.
+    std::string scope_of(const std::string &name)
+    {
+        auto end = name.find("::");
+        if (end == std::string::npos)
+            return "";
+        auto scope = name.substr(0, end);
+        // Skip the return type of a function template.
+        if (auto space = scope.rfind(' '); space != std::string::npos)
+            scope = scope.substr(space + 1);
+        return scope.substr(0, scope.find('<'));
+    }
+
+    /// @brief Where the code of each package can be recognized.
+    struct Origins
+    {
+        /// The package of each global symbol defined by a static library.
+        std::unordered_map<std::string, std::string> symbols;
+        /// The package of each source file, by its name. Names used by several packages are empty.
+        std::unordered_map<std::string, std::string> files;
+        /// The package of each namespace named after a package.
+        std::unordered_map<std::string, std::string> scopes;
+
+        void add_file(const std::string &file, const std::string &package)
+        {
+            auto [iter, inserted] = this->files.emplace(file, package);
+            if (!inserted && iter->second != package)
+                iter->second.clear();
+        }
+
+        void add_package(const std::string &package)
+        {
+            this->scopes.emplace(replace(package, "-", "_"), package);
+        }
+    };
+
+    /// @brief Get the package which builds a library, from `lib<name>.a` or `<name>.lib`.
+    std::string library_package(const fs::path &file)
+    {
+        auto name = file.filename().string();
+        name = name.substr(0, name.find('.'));
+        return name.starts_with("lib") && file.extension() != ".lib" ? name.substr(3) : name;
+    }
+
+    std::string read_binary(const fs::path &file)
+    {
+        std::ifstream ifs(file, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    /// @brief Read an artifact, with the members of a thin archive read from the objects it references.
+    /// @return The file, or a full archive of the objects if it is a thin archive of `[build] thin_archives`.
+    std::string read_artifact(const fs::path &file)
+    {
+        auto data = read_binary(file);
+        if (!data.starts_with("!<thin>\n"))
+            return data;
+        std::string full = "!<arch>\n";
+        std::string_view view = data, long_names;
+        size_t offset = 8;
+        while (offset + 60 <= view.size())
+        {
+            auto header = view.substr(offset, 60);
+            auto name = header.substr(0, 16);
+            name = name.substr(0, name.find_last_not_of(' ') + 1);
+            offset += 60;
+            // Only the symbol index and the names are stored, the members are files of their own.
+            if (name == "/" || name == "/SYM64/" || name == "//")
+            {
+                auto size = std::strtoull(std::string(header.substr(48, 10)).c_str(), nullptr, 10);
+                if (size > view.size() - offset)
+                    break;
+                if (name == "//")
+                    long_names = view.substr(offset, size);
+                offset += size + (size & 1);
+                continue;
+            }
+            std::string_view path = name;
+            if (name.size() > 1 && name[0] == '/' && std::isdigit(static_cast<unsigned char>(name[1])))
+            {
+                auto at = std::strtoull(std::string(name.substr(1)).c_str(), nullptr, 10);
+                path = at < long_names.size() ? long_names.substr(at) : std::string_view{};
+                path = path.substr(0, path.find("/\n"));
+            }
+            else if (name.ends_with('/'))
+                path.remove_suffix(1);
+            auto object = fs::path(path).is_absolute() ? fs::path(path) : file.parent_path() / path;
+            // Written with the long names of BSD archives, which `read_archive` reads.
+            auto member = object.filename().string();
+            auto body = member + read_binary(object);
+            std::ostringstream oss;
+            oss << std::left << std::setw(16) << ("#1/" + std::to_string(member.size())) << std::setw(32) << "0"
+                << std::setw(10) << body.size() << "`\n";
+            full += oss.str() + body;
+            if (body.size() & 1)
+                full += '\n';
+        }
+        return full;
+    }
+
+    /// @brief Strip `.o` or `.obj` from the name of an object, leaving the name of its source.
+    std::string source_of(const std::string &object)
+    {
+        auto file = fs::path(object).filename();
+        if (file.extension() == ".o" || file.extension() == ".obj")
+            file.replace_extension();
+        return file.string();
+    }
+
+    Origins collect_origins(const fs::path &root, const std::string &name,
+                            const std::vector<std::string> &dependencies)
+    {
+        Origins origins;
+        origins.add_package(name);
+        for (const auto &dependency : dependencies)
+            origins.add_package(dependency);
+        std::error_code ec;
+        auto lib = Resource::lib(root);
+        for (auto iter = fs::recursive_directory_iterator(lib, ec); !ec && iter != fs::end(iter); iter.increment(ec))
+        {
+            if (!iter->is_regular_file(ec))
+                continue;
+            auto data = read_artifact(iter->path());
+            if (!data.starts_with("!<arch>\n"))
+                continue;
+            auto package = library_package(iter->path());
+            origins.add_package(package);
+            for (const auto &[member, body] : read_archive(data))
+            {
+                origins.add_file(source_of(member), package);
+                if (auto object = read_elf(body))
+                    for (const auto &symbol : object->symbols)
+                        if (!symbol.local)
+                            origins.symbols.emplace(symbol.name, package);
+            }
+        }
+        // The sources of the root package are compiled into its binaries directly.
+        for (const auto &dir : {"src", "tests", "examples"})
+            for (auto iter = fs::recursive_directory_iterator(root / dir, ec); !ec && iter != fs::end(iter);
+                 iter.increment(ec))
+                if (iter->is_regular_file(ec))
+                    origins.add_file(iter->path().filename().string(), name);
+        return origins;
+    }
+
+    /// @brief The sizes of an artifact, by section, by package and by template.
+    struct Report
+    {
+        uint64_t file{0};
+        uint64_t text{0};
+        uint64_t data{0};
+        uint64_t bss{0};
+        std::vector<std::pair<std::string, uint64_t>> sections;
+        std::vector<std::pair<std::string, uint64_t>> packages;
+        /// The template, the number of instantiations and their size.
+        std::vector<std::tuple<std::string, size_t, uint64_t>> templates;
+        std::vector<std::pair<std::string, uint64_t>> symbols;
+        bool stripped{false};
+    };
+
+    template <typename T>
+    std::vector<std::pair<std::string, T>> sorted(const std::unordered_map<std::string, T> &sizes)
+    {
+        std::vector<std::pair<std::string, T>> rows(sizes.begin(), sizes.end());
+        std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b)
+                  { return a.second != b.second ? a.second > b.second : a.first < b.first; });
+        return rows;
+    }
+
+    Report analyze(const Image &image, uint64_t file_size, const Origins &origins, const std::string &owner)
+    {
+        Report report;
+        report.file = file_size;
+        report.stripped = image.stripped;
+        std::unordered_map<std::string, uint64_t> sections;
+        for (const auto &section : image.sections)
+        {
+            if (!section.alloc || section.size == 0)
+                continue;
+            if (section.nobits)
+                report.bss += section.size;
+            else if (section.write)
+                report.data += section.size;
+            else
+                report.text += section.size;
+            sections[section.name] += section.size;
+        }
+        report.sections = sorted(sections);
+
+        // The objects of a linked file are contiguous in each section, so the range covered by
+        // the local symbols of a source file also holds its global symbols.
+        struct Range
+        {
+            uint64_t begin, end;
+            std::string package;
+        };
+        std::map<std::pair<std::string, uint64_t>, Range> files;
+        for (const auto &symbol : image.symbols)
+        {
+            if (!symbol.local || symbol.file.empty())
+                continue;
+            auto package = origins.files.find(source_of(symbol.file));
+            if (package == origins.files.end() || package->second.empty())
+                continue;
+            auto [iter, inserted] = files.emplace(std::make_pair(symbol.file, symbol.section),
+                                                  Range{symbol.address, symbol.address + symbol.size, package->second});
+            iter->second.begin = std::min(iter->second.begin, symbol.address);
+            iter->second.end = std::max(iter->second.end, symbol.address + symbol.size);
+        }
+        std::map<uint64_t, std::vector<Range>> ranges;
+        for (const auto &[key, range] : files)
+            ranges[key.second].push_back(range);
+
+        auto package_of = [&](const Symbol &symbol, const std::string &demangled) -> std::string
+        {
+            if (!symbol.local)
+                if (auto iter = origins.symbols.find(symbol.name); iter != origins.symbols.end())
+                    return iter->second;
+            if (!symbol.file.empty())
+                if (auto iter = origins.files.find(source_of(symbol.file));
+                    iter != origins.files.end() && !iter->second.empty())
+                    return iter->second;
+            if (auto iter = ranges.find(symbol.section); iter != ranges.end())
+                for (const auto &range : iter->second)
+                    if (symbol.address >= range.begin && symbol.address < range.end)
+                        return range.package;
+            auto scope = scope_of(demangled);
+            if (auto iter = origins.scopes.find(scope); iter != origins.scopes.end())
+                return iter->second;
+            if (scope == "std" || scope == "__gnu_cxx" || scope == "__cxxabiv1")
+                return "(std)";
+            return owner;
+        };
+
+        std::unordered_map<std::string, uint64_t> packages;
+        std::unordered_map<std::string, std::pair<size_t, uint64_t>> templates;
+        std::vector<std::pair<std::string, uint64_t>> symbols;
+        uint64_t attributed = 0;
+        for (const auto &symbol : image.symbols)
+        {
+            auto demangled = demangle(symbol.name);
+            packages[package_of(symbol, demangled)] += symbol.size;
+            attributed += symbol.size;
+            if (auto name = template_of(demangled))
+            {
+                auto &[count, size] = templates[*name];
+                count++;
+                size += symbol.size;
+            }
+            symbols.emplace_back(demangled, symbol.size);
+        }
+        // Padding, tables of the runtime and anything else without a symbol.
+        auto total = report.text + report.data + report.bss;
+        if (total > attributed)
+            packages["(no symbol)"] += total - attributed;
+        report.packages = sorted(packages);
+
+        for (const auto &[name, entry] : templates)
+            if (entry.first > 1)
+                report.templates.emplace_back(name, entry.first, entry.second);
+        std::sort(report.templates.begin(), report.templates.end(), [](const auto &a, const auto &b)
+                  { return std::get<2>(a) != std::get<2>(b) ? std::get<2>(a) > std::get<2>(b) : std::get<0>(a) < std::get<0>(b); });
+        std::sort(symbols.begin(), symbols.end(), [](const auto &a, const auto &b)
+                  { return a.second != b.second ? a.second > b.second : a.first < b.first; });
+        report.symbols = std::move(symbols);
+        return report;
+    }
+
+    std::string human(uint64_t bytes)
+    {
+        std::ostringstream oss;
+        if (bytes < 1024)
+            oss << bytes << " B";
+        else if (bytes < 1024 * 1024)
+            oss << std::fixed << std::setprecision(1) << bytes / 1024.0 << " KiB";
+        else
+            oss << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB";
+        return oss.str();
+    }
+
+    /// @brief The sizes saved with `--save`, by artifact, kind and name.
+    using Baseline = std::map<std::string, uint64_t>;
+
+    std::string baseline_key(const std::string &artifact, const std::string &kind, const std::string &name)
+    {
+        return artifact + "\t" + kind + "\t" + name;
+    }
+
+    Baseline read_baseline(const fs::path &file)
+    {
+        Baseline baseline;
+        std::ifstream ifs(file);
+        std::string line;
+        while (std::getline(ifs, line))
+        {
+            auto tab = line.rfind('\t');
+            if (tab == std::string::npos)
+                continue;
+            baseline[line.substr(0, tab)] = std::strtoull(line.c_str() + tab + 1, nullptr, 10);
+        }
+        return baseline;
+    }
+
+    /// @brief Format the change of a size since the baseline.
+    /// @param bytes Whether the value is a size in bytes rather than a count.
+    std::string delta(const std::optional<Baseline> &baseline, const std::string &key, uint64_t size,
+                      bool bytes = true)
+    {
+        if (!baseline)
+            return "";
+        auto iter = baseline->find(key);
+        if (iter == baseline->end())
+            return "  (new)";
+        if (iter->second == size)
+            return "";
+        auto format = [bytes](uint64_t value)
+        { return bytes ? human(value) : std::to_string(value); };
+        return size > iter->second ? "  (+" + format(size - iter->second) + ")"
+                                   : "  (-" + format(iter->second - size) + ")";
+    }
+
+    std::string shorten(const std::string &name)
+    {
+        return name.size() > 120 ? name.substr(0, 117) + "..." : name;
+    }
+
+    void print_rows(const std::string &title, const std::vector<std::pair<std::string, uint64_t>> &rows, size_t top,
+                    const std::function<std::string(const std::string &, uint64_t)> &suffix)
+    {
+        if (rows.empty())
+            return;
+        LOG_INFO("  ", title);
+        for (size_t i = 0; i < std::min(top, rows.size()); i++)
+        {
+            std::ostringstream oss;
+            oss << "    " << std::setw(10) << human(rows[i].second) << "  " << shorten(rows[i].first)
+                << suffix(rows[i].first, rows[i].second);
+            LOG_INFO(oss.str());
+        }
+    }
+}
+
+Size::Size(const cmd::Args &args) : Run(args)
+{
+    this->save = args.has_flag("save");
+    if (args.has_config("top") && !args.getConfig().at("top").empty())
+        this->top = std::stoul(args.getConfig().at("top")[0]);
+    if (args.has_config("baseline") && !args.getConfig().at("baseline").empty())
+        this->baseline_file = args.getConfig().at("baseline")[0];
+    else
+        this->baseline_file = Size::baseline(this->root);
+}
+
+fs::path Size::baseline(const fs::path &root)
+{
+    return Resource::target(root) / "size-baseline.tsv";
+}
+
+std::vector<fs::path> Size::artifacts()
+{
+    if (this->command)
+        return {this->get_artifact()};
+    // Configurations of multi-config generators are kept apart by directory.
+    auto other = this->is_release ? "Debug" : "Release";
+    std::vector<fs::path> result;
+    for (const auto &dir : {Resource::bin(this->root), Resource::lib(this->root), Resource::dll(this->root),
+                            Resource::mod(this->root)})
+    {
+        std::error_code ec;
+        for (auto iter = fs::recursive_directory_iterator(dir, ec); !ec && iter != fs::end(iter); iter.increment(ec))
+        {
+            if (iter->is_directory(ec) && iter->path().filename() == other)
+                iter.disable_recursion_pending();
+            if (!iter->is_regular_file(ec))
+                continue;
+            // Shared libraries are linked next to the binaries which are run.
+            auto linked = std::any_of(result.begin(), result.end(), [&](const fs::path &file)
+                                      { return fs::equivalent(file, iter->path(), ec); });
+            if (!linked)
+                result.push_back(iter->path());
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+int Size::run()
+{
+    auto toml_config = data::parse_toml_file<data::Default>(this->root / "cup.toml");
+    std::vector<std::string> dependencies;
+    if (toml_config.dependencies)
+        for (const auto &[name, _] : *toml_config.dependencies)
+            dependencies.push_back(name);
+    auto origins = collect_origins(this->root, toml_config.project.name, dependencies);
+
+    std::optional<Baseline> baseline;
+    if (!this->save && fs::exists(this->baseline_file))
+        baseline = read_baseline(this->baseline_file);
+    std::ostringstream saved;
+    auto files = this->artifacts();
+    size_t reported = 0;
+    for (const auto &file : files)
+    {
+        auto data = read_artifact(file);
+        auto image = read_image(data);
+        if (!image)
+        {
+            LOG_DEBUG("Skip ", file.string(), ", which is not an ELF file or archive.");
+            continue;
+        }
+        reported++;
+        auto artifact = file.lexically_relative(this->root).generic_string();
+        // Libraries are owned by the package named after them, binaries by the root package.
+        auto library = data.starts_with("!<arch>\n") || file.filename().string().find(".so") != std::string::npos;
+        auto owner = library ? library_package(file) : toml_config.project.name;
+        auto report = analyze(*image, fs::file_size(file), origins, owner);
+
+        auto total = report.text + report.data + report.bss;
+        LOG_MSG(artifact, ": ", human(report.file), " on disk, ", human(total), " in memory",
+                delta(baseline, baseline_key(artifact, "total", ""), total));
+        LOG_INFO("  text ", human(report.text), ", data ", human(report.data), ", bss ", human(report.bss));
+        if (image->exported)
+        {
+            LOG_INFO("  ", *image->exported, " exported dynamic symbols",
+                     delta(baseline, baseline_key(artifact, "dynsym", ""), *image->exported, false));
+            saved << baseline_key(artifact, "dynsym", "") << "\t" << *image->exported << "\n";
+        }
+        if (report.stripped)
+            LOG_WARN("  The file is stripped, only the dynamic symbols are attributed.");
+        saved << baseline_key(artifact, "total", "") << "\t" << total << "\n";
+        for (const auto &[name, size] : report.sections)
+            saved << baseline_key(artifact, "section", name) << "\t" << size << "\n";
+        for (const auto &[name, size] : report.packages)
+            saved << baseline_key(artifact, "package", name) << "\t" << size << "\n";
+
+        print_rows("Sections:", report.sections, this->top, [&](const std::string &name, uint64_t size)
+                   { return delta(baseline, baseline_key(artifact, "section", name), size); });
+        print_rows("Packages:", report.packages, report.packages.size(), [&](const std::string &name, uint64_t size)
+                   {
+                       std::ostringstream oss;
+                       oss << std::fixed << std::setprecision(1) << "  " << (total ? 100.0 * size / total : 0) << "%"
+                           << delta(baseline, baseline_key(artifact, "package", name), size);
+                       return oss.str();
+                   });
+        if (!report.templates.empty())
+        {
+            LOG_INFO("  Templates (instantiations):");
+            for (size_t i = 0; i < std::min(this->top, report.templates.size()); i++)
+            {
+                const auto &[name, count, size] = report.templates[i];
+                std::ostringstream oss;
+                oss << "    " << std::setw(10) << human(size) << std::setw(7) << count << "x  " << shorten(name);
+                LOG_INFO(oss.str());
+            }
+        }
+        print_rows("Largest symbols:", report.symbols, this->top, [](const std::string &, uint64_t)
+                   { return std::string(); });
+        // Artifacts of the baseline which are gone.
+        if (baseline)
+            for (const auto &[key, size] : *baseline)
+                if (key.starts_with(artifact + "\tpackage\t") &&
+                    std::none_of(report.packages.begin(), report.packages.end(), [&](const auto &row)
+                                 { return key == baseline_key(artifact, "package", row.first); }))
+                {
+                    std::ostringstream oss;
+                    oss << "    " << std::setw(10) << "-" << "  " << key.substr(key.rfind('\t') + 1) << "  (-"
+                        << human(size) << ")";
+                    LOG_INFO(oss.str());
+                }
+    }
+    if (reported == 0)
+        throw std::runtime_error("No ELF artifact was found, build the project first.");
+
+    if (this->save)
+    {
+        fs::create_directories(this->baseline_file.parent_path());
+        auto temp = this->baseline_file;
+        temp += ".tmp";
+        std::ofstream(temp, std::ios::binary) << saved.str();
+        fs::rename(temp, this->baseline_file);
+        LOG_INFO("Saved the sizes to ", this->baseline_file.string());
+    }
+    return 0;
+}
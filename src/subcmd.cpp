@@ -102,6 +102,34 @@ const std::unordered_map<std::string, std::string> Help::help_info = {
         "run",
 #include "template/help/run.txt"
     },
+    {
+        "daemon",
+#include "template/help/daemon.txt"
+    },
+    {
+        "watch",
+#include "template/help/watch.txt"
+    },
+    {
+        "worker",
+#include "template/help/worker.txt"
+    },
+    {
+        "size",
+#include "template/help/size.txt"
+    },
+    {
+        "ifs",
+#include "template/help/ifs.txt"
+    },
+    {
+        "ar",
+#include "template/help/ar.txt"
+    },
+    {
+        "plugin-host",
+#include "template/help/plugin-host.txt"
+    },
 };
 
 Help::Help(const cmd::Args &args) : SubCommand(args), args(args)
@@ -268,33 +296,57 @@ Run::Run(const cmd::Args &args) : Build(args)
         this->args = join(args.getConfig().at("args"), " ");
 }
 
-int Run::run()
+RunProjectData Run::project_data() const
 {
     auto toml_config = data::parse_toml_file<data::Default>(this->root / "cup.toml");
-    RunProjectData data{
+    return RunProjectData{
         .command = this->command,
         .root = this->root,
         .name = toml_config.project.name,
         .is_debug = !this->is_release,
     };
-    auto loader = PluginLoader(toml_config.project.type);
+}
+
+std::string Run::project_type() const
+{
+    return data::parse_toml_file<data::Default>(this->root / "cup.toml").project.type;
+}
+
+void Run::build_target()
+{
+    auto data = this->project_data();
+    auto loader = PluginLoader(this->project_type(), this->isolate);
     auto result = loader->get_target(data);
     if (result.is_error())
         throw std::runtime_error(result.error());
     this->target = result.ok();
-    auto ret = Build::run();
-    if (ret)
-        return ret;
+    Build::run();
+}
+
+fs::path Run::get_artifact()
+{
+    auto data = this->project_data();
+    auto loader = PluginLoader(this->project_type(), this->isolate);
     auto result_ = loader->run_project(data);
     if (result_.is_error())
         throw std::runtime_error(result_.error());
     auto path = result_.ok();
     if (path.is_relative())
         path = this->root / path;
-    path = path.lexically_normal();
-    auto cmd = path.string() + " " + this->args;
-    LOG_MSG("# Running: ", path.string());
-    ret = std::system(cmd.c_str());
+    return path.lexically_normal();
+}
+
+std::string Run::get_executable()
+{
+    return this->get_artifact().string() + " " + this->args;
+}
+
+int Run::run()
+{
+    this->build_target();
+    auto cmd = this->get_executable();
+    LOG_MSG("# Running: ", cmd);
+    auto ret = std::system(cmd.c_str());
     if (ret)
         LOG_WARN("# Exit Code: ", ret);
     else
@@ -324,4 +376,17 @@ std::pair<fs::path, std::string> get_path(const data::Dependency &dep, bool down
     }
     else
         throw std::runtime_error("Neither 'path' nor 'url' is specified.");
-}
\ No newline at end of file
+}
+PluginHostMode::PluginHostMode(const cmd::Args &args) : SubCommand(args)
+{
+    const auto &positions = args.getPositions();
+    if (positions.size() < 3)
+        throw std::runtime_error("Usage: cup plugin-host <type> <fd>");
+    this->type = positions[1];
+    this->fd = std::stoi(positions[2]);
+}
+
+int PluginHostMode::run()
+{
+    return PluginHost::serve(this->type, this->fd);
+}
@@ -0,0 +1,216 @@
+#include "toolchain.h"
+#include "fingerprint.h"
+#include "res.h"
+#include "log.h"
+#include "cmd/cmake.h"
+#include "cmd/tools.h"
+#include "utils/utils.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <random>
+#include <unordered_map>
+
+/// The environment variables which CMake reads to select the compilers and their flags.
+static const char *const ENVIRONMENT[] = {"CC", "CXX", "ASM", "OBJC", "OBJCXX", "CUDACXX",
+                                          "CFLAGS", "CXXFLAGS", "ASMFLAGS", "LDFLAGS", "PATH"};
+
+static std::string read_binary(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+/// @brief Identify the binary of a compiler by its size and modification time.
+/// @return The identity, or an empty string if the compiler does not exist.
+static std::string identity(const fs::path &compiler)
+{
+    std::error_code ec;
+    auto size = fs::file_size(compiler, ec);
+    if (ec)
+        return "";
+    auto time = fs::last_write_time(compiler, ec);
+    if (ec)
+        return "";
+    return std::to_string(size) + " " + std::to_string(time.time_since_epoch().count());
+}
+
+/// @brief Quote a value as an argument of CMake.
+static std::string quote(const std::string &value)
+{
+    std::string result = "\"";
+    for (auto c : value)
+    {
+        if (c == '\\' || c == '"' || c == '$')
+            result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+/// @brief Find the compiler which CMake selects for a language.
+/// @return The path of the compiler, or nothing if it is not found.
+static std::optional<fs::path> compiler_of(const std::string &language)
+{
+    // The variables and the default names which CMake searches, in its order.
+    static const std::unordered_map<std::string, std::pair<const char *, std::vector<std::string>>> COMPILERS{
+        {"C", {"CC", {"cc", "gcc", "cl", "clang"}}},
+        {"CXX", {"CXX", {"c++", "g++", "cl", "clang++"}}},
+        {"ASM", {"ASM", {"cc", "gcc", "clang"}}},
+        {"OBJC", {"OBJC", {"cc", "clang"}}},
+        {"OBJCXX", {"OBJCXX", {"c++", "clang++"}}},
+        {"CUDA", {"CUDACXX", {"nvcc"}}},
+    };
+    auto iter = COMPILERS.find(language);
+    if (iter == COMPILERS.end())
+        return std::nullopt;
+    const auto &[variable, names] = iter->second;
+    if (auto value = std::getenv(variable); value && *value)
+    {
+        // The variable may carry flags after the compiler.
+        auto compiler = fs::path(split(value, " ")[0]);
+        return compiler.has_parent_path() ? std::optional(compiler) : cmd::ToolRegistry::which(compiler.string());
+    }
+    for (const auto &name : names)
+        if (auto path = cmd::ToolRegistry::which(name))
+            return path;
+    return std::nullopt;
+}
+
+ToolchainCache ToolchainCache::of(const fs::path &source_dir, const std::string &generator,
+                                  const std::vector<std::string> &languages)
+{
+    // Only what selects and configures the compilers is part of the key. The paths of the
+    // project, which are in the launcher, the commands of cup and the names of the scripts,
+    // are left out, so that every checkout with the same toolchain shares the snapshot.
+    std::ostringstream key;
+    key << "cmake " << cmd::CMake::version() << "\n"
+        << "generator " << generator << "\n"
+        << "languages " << join(languages, " ") << "\n";
+    key << environment();
+    for (const auto &language : languages)
+    {
+        // A compiler updated in place, or selected by another symlink, gets another snapshot.
+        auto compiler = compiler_of(language);
+        std::error_code ec;
+        auto resolved = compiler ? fs::canonical(*compiler, ec) : fs::path();
+        key << "compiler " << language << " " << resolved.generic_string() << " " << identity(resolved) << "\n";
+    }
+    // The scripts of the plugins before `project()` may select the compilers as well.
+    auto lists = read_binary(source_dir / "CMakeLists.txt");
+    std::istringstream iss(lists.substr(0, lists.find("\nproject(")));
+    std::string line;
+    while (std::getline(iss, line))
+    {
+        if (line.starts_with("cmake_minimum_required("))
+            key << line << "\n";
+        if (!line.starts_with("include(") || !line.ends_with(")"))
+            continue;
+        std::istringstream script(read_binary(source_dir / line.substr(8, line.size() - 9)));
+        std::string command;
+        while (std::getline(script, command))
+            if (command.find("CMAKE_") != std::string::npos)
+                key << command << "\n";
+    }
+
+    ToolchainCache cache;
+    cache.dir = Resource::toolchains() / Fingerprint::hash(key.str());
+    return cache;
+}
+
+std::string ToolchainCache::environment()
+{
+    std::string result;
+    for (auto name : ENVIRONMENT)
+    {
+        auto value = std::getenv(name);
+        result += std::string(name) + "=" + (value ? value : "") + "\n";
+    }
+    return result;
+}
+
+bool ToolchainCache::supported(const std::string &generator)
+{
+    return generator.ends_with("Makefiles") || generator.starts_with("Ninja");
+}
+
+std::optional<fs::path> ToolchainCache::seed(const fs::path &build_dir) const
+{
+    if (!fs::exists(this->dir / "init.cmake"))
+        return std::nullopt;
+    std::ifstream compilers(this->dir / "compilers");
+    std::string line;
+    while (std::getline(compilers, line))
+    {
+        auto tab = line.find('\t');
+        if (tab != std::string::npos && identity(line.substr(0, tab)) == line.substr(tab + 1))
+            continue;
+        LOG_INFO("The toolchain has changed since its snapshot: ", line.substr(0, tab));
+        std::error_code ec;
+        fs::remove_all(this->dir, ec);
+        return std::nullopt;
+    }
+
+    auto platform = build_dir / "CMakeFiles" / cmd::CMake::version();
+    fs::create_directories(platform);
+    for (const auto &entry : fs::directory_iterator(this->dir / "platform"))
+        fs::copy_file(entry.path(), platform / entry.path().filename(), fs::copy_options::overwrite_existing);
+    return this->dir / "init.cmake";
+}
+
+void ToolchainCache::store(const fs::path &build_dir) const
+{
+    auto platform = build_dir / "CMakeFiles" / cmd::CMake::version();
+    if (fs::exists(this->dir) || !fs::exists(platform / "CMakeSystem.cmake"))
+        return;
+
+    // The paths of the tools found while probing, which are not in the platform files.
+    std::ostringstream init;
+    std::ostringstream compilers;
+    init << "# Generated by cup\n"
+         << "set(CMAKE_PLATFORM_INFO_INITIALIZED 1 CACHE INTERNAL \"\")\n";
+    std::istringstream cache(read_binary(build_dir / "CMakeCache.txt"));
+    std::string line;
+    while (std::getline(cache, line))
+    {
+        if (line.ends_with('\r'))
+            line.pop_back();
+        auto colon = line.find(':');
+        auto equal = line.find('=');
+        if (!line.starts_with("CMAKE_") || colon == std::string::npos || equal == std::string::npos || equal < colon)
+            continue;
+        auto name = line.substr(0, colon);
+        auto type = line.substr(colon + 1, equal - colon - 1);
+        auto value = line.substr(equal + 1);
+        if (type == "FILEPATH")
+        {
+            init << "set(" << name << " " << quote(value) << " CACHE FILEPATH \"\")\n";
+            if (name.ends_with("_COMPILER"))
+                compilers << value << "\t" << identity(value) << "\n";
+        }
+        else if (name == "CMAKE_EXECUTABLE_FORMAT" || name == "CMAKE_UNAME")
+            init << "set(" << name << " " << quote(value) << " CACHE INTERNAL \"\")\n";
+    }
+    if (compilers.str().empty())
+        return;
+
+    // Written aside and renamed, so that concurrent builds never see a partial snapshot.
+    auto temp = this->dir;
+    temp += ".tmp" + std::to_string(std::random_device{}());
+    fs::create_directories(temp / "platform");
+    for (const auto &entry : fs::directory_iterator(platform))
+    {
+        auto file = entry.path().filename().string();
+        if (file == "CMakeSystem.cmake" || (file.starts_with("CMake") && file.ends_with("Compiler.cmake")))
+            fs::copy_file(entry.path(), temp / "platform" / file);
+    }
+    std::ofstream(temp / "init.cmake", std::ios::binary) << init.str();
+    std::ofstream(temp / "compilers", std::ios::binary) << compilers.str();
+    std::error_code ec;
+    fs::rename(temp, this->dir, ec);
+    if (ec)
+        fs::remove_all(temp, ec);
+    else
+        LOG_INFO("Saved a snapshot of the toolchain to ", this->dir.string());
+}
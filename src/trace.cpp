@@ -0,0 +1,506 @@
+#include "trace.h"
+#include "log.h"
+#include "utils/utils.h"
+#include <cctype>
+#include <cstdio>
+#include <optional>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    /// @brief A JSON value, enough to read and rewrite the traces of Clang.
+    struct Json
+    {
+        enum class Kind
+        {
+            Null,
+            Bool,
+            Number,
+            String,
+            Array,
+            Object,
+        } kind{Kind::Null};
+        bool boolean{false};
+        double number{0};
+        std::string string;
+        std::vector<Json> array;
+        std::vector<std::pair<std::string, Json>> object;
+
+        const Json *get(const std::string &key) const
+        {
+            for (const auto &[name, value] : this->object)
+                if (name == key)
+                    return &value;
+            return nullptr;
+        }
+
+        Json *get(const std::string &key)
+        {
+            return const_cast<Json *>(static_cast<const Json *>(this)->get(key));
+        }
+
+        void set(const std::string &key, Json value)
+        {
+            if (auto item = this->get(key))
+                *item = std::move(value);
+            else
+                this->object.emplace_back(key, std::move(value));
+        }
+
+        std::string text(const std::string &key) const
+        {
+            auto value = this->get(key);
+            return value && value->kind == Kind::String ? value->string : "";
+        }
+
+        double value(const std::string &key) const
+        {
+            auto value = this->get(key);
+            return value && value->kind == Kind::Number ? value->number : 0;
+        }
+
+        static Json of(double number)
+        {
+            Json json;
+            json.kind = Kind::Number;
+            json.number = number;
+            return json;
+        }
+
+        static Json of(const std::string &string)
+        {
+            Json json;
+            json.kind = Kind::String;
+            json.string = string;
+            return json;
+        }
+    };
+
+    class Parser
+    {
+        const std::string &text;
+        size_t pos{0};
+
+        [[noreturn]] void fail() const
+        {
+            throw std::runtime_error("Invalid JSON at offset " + std::to_string(this->pos));
+        }
+
+        void skip()
+        {
+            while (this->pos < this->text.size() && std::isspace(static_cast<unsigned char>(this->text[this->pos])))
+                this->pos++;
+        }
+
+        char peek()
+        {
+            this->skip();
+            if (this->pos >= this->text.size())
+                this->fail();
+            return this->text[this->pos];
+        }
+
+        void expect(char c)
+        {
+            if (this->peek() != c)
+                this->fail();
+            this->pos++;
+        }
+
+        std::string parse_string()
+        {
+            this->expect('"');
+            std::string result;
+            while (this->pos < this->text.size() && this->text[this->pos] != '"')
+            {
+                auto c = this->text[this->pos++];
+                if (c != '\\')
+                {
+                    result += c;
+                    continue;
+                }
+                if (this->pos >= this->text.size())
+                    this->fail();
+                c = this->text[this->pos++];
+                switch (c)
+                {
+                case 'b':
+                    result += '\b';
+                    break;
+                case 'f':
+                    result += '\f';
+                    break;
+                case 'n':
+                    result += '\n';
+                    break;
+                case 'r':
+                    result += '\r';
+                    break;
+                case 't':
+                    result += '\t';
+                    break;
+                case 'u':
+                {
+                    if (this->pos + 4 > this->text.size())
+                        this->fail();
+                    auto code = static_cast<unsigned>(std::stoul(this->text.substr(this->pos, 4), nullptr, 16));
+                    this->pos += 4;
+                    // Surrogate pairs are kept as two code points, which is enough for names.
+                    if (code < 0x80)
+                        result += static_cast<char>(code);
+                    else if (code < 0x800)
+                    {
+                        result += static_cast<char>(0xc0 | (code >> 6));
+                        result += static_cast<char>(0x80 | (code & 0x3f));
+                    }
+                    else
+                    {
+                        result += static_cast<char>(0xe0 | (code >> 12));
+                        result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                        result += static_cast<char>(0x80 | (code & 0x3f));
+                    }
+                    break;
+                }
+                default:
+                    result += c;
+                }
+            }
+            this->expect('"');
+            return result;
+        }
+
+    public:
+        Parser(const std::string &text) : text(text) {}
+
+        Json parse()
+        {
+            Json json;
+            auto c = this->peek();
+            if (c == '{')
+            {
+                json.kind = Json::Kind::Object;
+                this->pos++;
+                if (this->peek() == '}')
+                {
+                    this->pos++;
+                    return json;
+                }
+                while (true)
+                {
+                    auto key = this->parse_string();
+                    this->expect(':');
+                    json.object.emplace_back(std::move(key), this->parse());
+                    if (this->peek() == '}')
+                        break;
+                    this->expect(',');
+                }
+                this->pos++;
+            }
+            else if (c == '[')
+            {
+                json.kind = Json::Kind::Array;
+                this->pos++;
+                if (this->peek() == ']')
+                {
+                    this->pos++;
+                    return json;
+                }
+                while (true)
+                {
+                    json.array.push_back(this->parse());
+                    if (this->peek() == ']')
+                        break;
+                    this->expect(',');
+                }
+                this->pos++;
+            }
+            else if (c == '"')
+            {
+                json.kind = Json::Kind::String;
+                json.string = this->parse_string();
+            }
+            else if (this->text.compare(this->pos, 4, "true") == 0 || this->text.compare(this->pos, 5, "false") == 0)
+            {
+                json.kind = Json::Kind::Bool;
+                json.boolean = c == 't';
+                this->pos += json.boolean ? 4 : 5;
+            }
+            else if (this->text.compare(this->pos, 4, "null") == 0)
+                this->pos += 4;
+            else
+            {
+                json.kind = Json::Kind::Number;
+                size_t used = 0;
+                try
+                {
+                    json.number = std::stod(this->text.substr(this->pos, 32), &used);
+                }
+                catch (const std::exception &)
+                {
+                    this->fail();
+                }
+                this->pos += used;
+            }
+            return json;
+        }
+    };
+
+    void write(std::ostream &os, const Json &json)
+    {
+        switch (json.kind)
+        {
+        case Json::Kind::Null:
+            os << "null";
+            break;
+        case Json::Kind::Bool:
+            os << (json.boolean ? "true" : "false");
+            break;
+        case Json::Kind::Number:
+        {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.17g", json.number);
+            os << buffer;
+            break;
+        }
+        case Json::Kind::String:
+            os << '"';
+            for (auto c : json.string)
+            {
+                if (c == '"' || c == '\\')
+                    os << '\\' << c;
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    os << buffer;
+                }
+                else
+                    os << c;
+            }
+            os << '"';
+            break;
+        case Json::Kind::Array:
+            os << '[';
+            for (size_t i = 0; i < json.array.size(); i++)
+            {
+                if (i > 0)
+                    os << ',';
+                write(os, json.array[i]);
+            }
+            os << ']';
+            break;
+        case Json::Kind::Object:
+            os << '{';
+            for (size_t i = 0; i < json.object.size(); i++)
+            {
+                if (i > 0)
+                    os << ',';
+                write(os, Json::of(json.object[i].first));
+                os << ':';
+                write(os, json.object[i].second);
+            }
+            os << '}';
+            break;
+        }
+    }
+
+    std::optional<Json> read_trace(const fs::path &file)
+    {
+        std::ifstream ifs(file, std::ios::binary);
+        std::string text(std::istreambuf_iterator<char>(ifs), {});
+        if (text.find("\"traceEvents\"") == std::string::npos)
+            return std::nullopt;
+        try
+        {
+            auto json = Parser(text).parse();
+            auto events = json.get("traceEvents");
+            if (json.kind != Json::Kind::Object || !events || events->kind != Json::Kind::Array)
+                return std::nullopt;
+            return json;
+        }
+        catch (const std::exception &e)
+        {
+            LOG_WARN("Skip the trace ", file.string(), ": ", e.what());
+            return std::nullopt;
+        }
+    }
+
+    void print_table(const std::string &title, const std::vector<TimeTrace::Entry> &rows, size_t top, bool phases)
+    {
+        if (rows.empty())
+            return;
+        LOG_INFO(title);
+        for (size_t i = 0; i < std::min(top, rows.size()); i++)
+        {
+            const auto &row = rows[i];
+            auto name = row.name.size() > 120 ? row.name.substr(0, 117) + "..." : row.name;
+            std::ostringstream oss;
+            oss << "    " << std::fixed << std::setprecision(1) << std::setw(10) << row.frontend_ms << " ms";
+            if (phases)
+                oss << std::setw(10) << row.backend_ms << " ms";
+            else
+                oss << std::setw(7) << row.count << "x";
+            oss << "  " << name;
+            LOG_INFO(oss.str());
+        }
+    }
+}
+
+/// @brief Check whether a file is the trace of a translation unit, such as `main.cpp.json`.
+static bool is_trace(const fs::path &file)
+{
+    return file.extension() == ".json" && fs::path(file.stem()).has_extension();
+}
+
+TimeTrace TimeTrace::collect(const fs::path &build_dir,
+                             const std::vector<std::pair<std::string, fs::path>> &packages)
+{
+    TimeTrace trace;
+    trace.build_dir = build_dir;
+    std::error_code ec;
+    for (auto iter = fs::recursive_directory_iterator(build_dir, ec); !ec && iter != fs::end(iter); iter.increment(ec))
+        if (iter->is_regular_file(ec) && is_trace(iter->path()))
+            trace.traces.push_back(iter->path());
+    std::sort(trace.traces.begin(), trace.traces.end());
+
+    // The package owning a header is the one with the longest matching directory.
+    auto label = [&packages](const std::string &path)
+    {
+        const std::pair<std::string, fs::path> *owner = nullptr;
+        auto file = fs::path(path).lexically_normal();
+        for (const auto &package : packages)
+        {
+            auto relative = file.lexically_relative(package.second);
+            if (!relative.empty() && *relative.begin() != ".." &&
+                (owner == nullptr || package.second.string().size() > owner->second.string().size()))
+                owner = &package;
+        }
+        return owner ? owner->first + ": " + file.lexically_relative(owner->second).generic_string() : path;
+    };
+
+    std::unordered_map<std::string, Entry> headers, templates;
+    std::vector<fs::path> valid;
+    for (const auto &file : trace.traces)
+    {
+        auto json = read_trace(file);
+        if (!json)
+            continue;
+        valid.push_back(file);
+        Entry unit{.name = file.lexically_relative(build_dir).replace_extension().generic_string(), .count = 1};
+        double frontend = 0, backend = 0;
+        for (const auto &event : json->get("traceEvents")->array)
+        {
+            auto name = event.text("name");
+            auto dur = event.value("dur") / 1000;
+            const auto *args = event.get("args");
+            auto detail = args ? args->text("detail") : std::string();
+            if (name == "Total Frontend")
+                unit.frontend_ms = dur;
+            else if (name == "Total Backend")
+                unit.backend_ms = dur;
+            else if (name == "Frontend")
+                frontend += dur;
+            else if (name == "Backend")
+                backend += dur;
+            else if (name == "Source" && !detail.empty())
+            {
+                auto &entry = headers[detail];
+                entry.frontend_ms += dur;
+                entry.count++;
+            }
+            else if ((name == "InstantiateClass" || name == "InstantiateFunction") && !detail.empty())
+            {
+                auto &entry = templates[detail];
+                entry.frontend_ms += dur;
+                entry.count++;
+            }
+        }
+        // Older versions of Clang have no summary events.
+        unit.frontend_ms = unit.frontend_ms > 0 ? unit.frontend_ms : frontend;
+        unit.backend_ms = unit.backend_ms > 0 ? unit.backend_ms : backend;
+        trace.units.push_back(unit);
+    }
+    trace.traces = valid;
+
+    for (auto &[name, entry] : headers)
+    {
+        entry.name = label(name);
+        trace.headers.push_back(entry);
+    }
+    for (auto &[name, entry] : templates)
+    {
+        entry.name = name;
+        trace.templates.push_back(entry);
+    }
+    auto by_time = [](const Entry &a, const Entry &b)
+    { return a.frontend_ms + a.backend_ms > b.frontend_ms + b.backend_ms; };
+    std::sort(trace.units.begin(), trace.units.end(), by_time);
+    std::sort(trace.headers.begin(), trace.headers.end(), by_time);
+    std::sort(trace.templates.begin(), trace.templates.end(), by_time);
+    return trace;
+}
+
+void TimeTrace::print(size_t top) const
+{
+    LOG_INFO("Time trace of ", this->traces.size(), " translation units:");
+    print_table("Slowest translation units (frontend, backend):", this->units, top, true);
+    print_table("Most expensive headers (cumulative parse time, includes):", this->headers, top, false);
+    print_table("Most expensive template instantiations (cumulative time, instantiations):", this->templates, top,
+                false);
+}
+
+void TimeTrace::merge(const fs::path &file) const
+{
+    std::vector<std::pair<std::string, Json>> traces;
+    double start = -1;
+    for (const auto &trace : this->traces)
+        if (auto json = read_trace(trace))
+        {
+            auto begin = json->value("beginningOfTime");
+            start = start < 0 || begin < start ? begin : start;
+            traces.emplace_back(trace.lexically_relative(this->build_dir).replace_extension().generic_string(),
+                                std::move(*json));
+        }
+
+    std::ostringstream oss;
+    oss << "{\"traceEvents\":[";
+    auto first = true;
+    for (size_t i = 0; i < traces.size(); i++)
+    {
+        auto &[name, json] = traces[i];
+        // The translation units are placed on the timeline of the build, each as a process.
+        auto offset = json.value("beginningOfTime") - start;
+        auto pid = Json::of(static_cast<double>(i + 1));
+        Json process;
+        process.kind = Json::Kind::Object;
+        process.set("ph", Json::of(std::string("M")));
+        process.set("name", Json::of(std::string("process_name")));
+        process.set("pid", pid);
+        Json args;
+        args.kind = Json::Kind::Object;
+        args.set("name", Json::of(name));
+        process.set("args", args);
+        oss << (first ? "" : ",");
+        write(oss, process);
+        first = false;
+        for (auto &event : json.get("traceEvents")->array)
+        {
+            auto kind = event.text("ph");
+            if (event.text("name").starts_with("Total ") || (kind == "M" && event.text("name") == "process_name"))
+                continue;
+            event.set("pid", pid);
+            if (auto ts = event.get("ts"); ts && ts->kind == Json::Kind::Number)
+                ts->number += offset;
+            oss << ",";
+            write(oss, event);
+        }
+    }
+    oss << "],\"displayTimeUnit\":\"ms\"}\n";
+    std::ofstream(file, std::ios::binary) << oss.str();
+}
@@ -0,0 +1,210 @@
+#include "watch.h"
+#include "watcher.h"
+#include "res.h"
+#include "log.h"
+#include <set>
+#include <csignal>
+#include <cstdio>
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/// Events closer than this are handled as one change.
+static constexpr int DEBOUNCE_MS = 150;
+
+/// @brief A `Run` whose target follows the mode: `cup watch run <target>`.
+class WatchTarget : public Run
+{
+public:
+    WatchTarget(const cmd::Args &args) : Run(args)
+    {
+        const auto &positions = args.getPositions();
+        this->command = positions.size() > 2 ? std::optional(positions[2]) : std::nullopt;
+    }
+    using Run::build_target;
+    using Run::get_executable;
+};
+
+static volatile std::sig_atomic_t interrupted = 0;
+
+static void on_interrupt(int)
+{
+    interrupted = 1;
+}
+
+/// @brief List the files which the generation depends on.
+static std::set<fs::path> list_files(const std::vector<fs::path> &packages)
+{
+    std::set<fs::path> files;
+    for (const auto &package : packages)
+    {
+        for (const auto &sub : {"src", "include", "export", "tests", "examples"})
+        {
+            if (!fs::is_directory(package / sub))
+                continue;
+            std::error_code ec;
+            for (auto it = fs::recursive_directory_iterator(package / sub, ec);
+                 it != fs::recursive_directory_iterator(); it.increment(ec))
+                files.insert(it->path());
+        }
+    }
+    return files;
+}
+
+#ifdef __linux__
+static pid_t spawn(const std::string &cmd)
+{
+    std::fflush(stdout);
+    std::cout.flush();
+    auto pid = fork();
+    if (pid == 0)
+    {
+        // A process group of its own, so that everything it starts is stopped with it.
+        setpgid(0, 0);
+        execl("/bin/sh", "sh", "-c", cmd.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    if (pid == -1)
+        throw std::runtime_error("Failed to start: " + cmd);
+    setpgid(pid, pid);
+    return pid;
+}
+
+static void report(int status)
+{
+    auto code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (code)
+        LOG_WARN("# Exit Code: ", code);
+    else
+        LOG_MSG("# Exit Code: ", code);
+}
+
+static bool reap(pid_t pid)
+{
+    int status = 0;
+    if (waitpid(pid, &status, WNOHANG) != pid)
+        return false;
+    report(status);
+    return true;
+}
+
+static void terminate(pid_t pid)
+{
+    LOG_MSG("# Stopping: ", pid);
+    kill(-pid, SIGTERM);
+    for (int i = 0; i < 50; i++)
+    {
+        if (waitpid(pid, nullptr, WNOHANG) == pid)
+            return;
+        usleep(100 * 1000);
+    }
+    kill(-pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+#endif
+
+Watch::Watch(const cmd::Args &args) : SubCommand(args), args(args)
+{
+    const auto &positions = args.getPositions();
+    auto mode = positions.size() > 1 ? positions[1] : "build";
+    if (mode != "build" && mode != "run")
+        throw std::runtime_error("Invalid watch mode '" + mode + "', expected 'build' or 'run'.");
+    this->run_mode = mode == "run";
+}
+
+int Watch::run()
+{
+#ifdef __linux__
+    Watcher watcher;
+    std::unique_ptr<Build> warm;
+    std::vector<fs::path> packages;
+    std::set<fs::path> files;
+    pid_t child = -1;
+    bool regenerate = true;
+    std::signal(SIGINT, on_interrupt);
+    std::signal(SIGTERM, on_interrupt);
+
+    // Until the first generation succeeds, at least the root package is watched.
+    {
+        fs::path root = ".";
+        if (this->args.has_config("dir") && !this->args.getConfig().at("dir").empty())
+            root = this->args.getConfig().at("dir")[0];
+        watcher.watch_package(fs::absolute(root).lexically_normal());
+    }
+
+    while (!interrupted)
+    {
+        try
+        {
+            WatchTarget target(this->args);
+            if (!regenerate && warm)
+                target.reuse_generation(*warm);
+            else
+                warm.reset();
+            target.build_target();
+            if (!warm)
+            {
+                warm = std::make_unique<Build>(static_cast<const Build &>(target));
+                // Downloaded packages never change, so only the local ones are watched.
+                packages.clear();
+                for (const auto &package : target.get_packages())
+                    if (!package.string().starts_with(Resource::packages().string()))
+                        packages.push_back(package);
+                watcher.clear();
+                for (const auto &package : packages)
+                    watcher.watch_package(package);
+                files = list_files(packages);
+            }
+            if (this->run_mode)
+            {
+                auto cmd = target.get_executable();
+                LOG_MSG("# Running: ", cmd);
+                child = spawn(cmd);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR(e.what());
+        }
+
+        LOG_MSG("# Watching for changes...");
+        std::vector<Watcher::Event> events;
+        while (events.empty() && !interrupted)
+        {
+            events = watcher.read(child == -1 ? -1 : 200);
+            if (child != -1 && reap(child))
+                child = -1;
+        }
+        if (interrupted)
+            break;
+        for (auto more = watcher.read(DEBOUNCE_MS); !more.empty(); more = watcher.read(DEBOUNCE_MS))
+            events.insert(events.end(), more.begin(), more.end());
+
+        // Only a changed manifest or file list requires a new generation,
+        // otherwise the build tool picks up the changed contents by itself.
+        regenerate = false;
+        bool structural = false;
+        for (const auto &event : events)
+        {
+            if (event.path.empty() || event.path.filename() == "cup.toml")
+                regenerate = true;
+            structural = structural || event.structural;
+        }
+        if (!regenerate && structural)
+            regenerate = list_files(packages) != files;
+        LOG_MSG("# Changed: ", events.front().path.string(), regenerate ? " (regenerate)" : "");
+
+        if (child != -1)
+        {
+            terminate(child);
+            child = -1;
+        }
+    }
+    if (child != -1)
+        terminate(child);
+    return 0;
+#else
+    throw std::runtime_error("Watching is not supported on this platform.");
+#endif
+}
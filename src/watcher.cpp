@@ -0,0 +1,146 @@
+#include "watcher.h"
+#include "log.h"
+#include <stdexcept>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+static constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                       IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+static constexpr uint32_t STRUCTURAL_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                            IN_DELETE_SELF | IN_MOVE_SELF | IN_Q_OVERFLOW;
+#endif
+
+bool Watcher::supported()
+{
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+Watcher::Watcher()
+{
+#ifdef __linux__
+    this->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->fd == -1)
+        throw std::runtime_error("Failed to initialize inotify.");
+#else
+    throw std::runtime_error("File watching is not supported on this platform.");
+#endif
+}
+
+Watcher::~Watcher()
+{
+#ifdef __linux__
+    if (this->fd != -1)
+        close(this->fd);
+#endif
+}
+
+void Watcher::watch(const fs::path &dir, bool recursive)
+{
+#ifdef __linux__
+    if (!fs::is_directory(dir))
+        return;
+    auto wd = inotify_add_watch(this->fd, dir.c_str(), WATCH_MASK);
+    if (wd == -1)
+    {
+        LOG_WARN("Failed to watch directory ", dir.string(), ". Is fs.inotify.max_user_watches too small?");
+        return;
+    }
+    this->dirs[wd] = {dir, recursive};
+    this->manifests.erase(wd);
+    if (!recursive)
+        return;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(dir, ec))
+        if (entry.is_directory() && !entry.is_symlink())
+            this->watch(entry.path(), true);
+#endif
+}
+
+void Watcher::watch_package(const fs::path &package)
+{
+#ifdef __linux__
+    for (const auto &sub : {"src", "include", "export", "tests", "examples"})
+        this->watch(package / sub, true);
+    auto wd = inotify_add_watch(this->fd, package.c_str(), WATCH_MASK);
+    if (wd == -1)
+    {
+        LOG_WARN("Failed to watch directory ", package.string(), ". Is fs.inotify.max_user_watches too small?");
+        return;
+    }
+    // The package directory itself holds the build output, so only its manifest is watched.
+    if (!this->dirs.contains(wd))
+    {
+        this->dirs[wd] = {package, false};
+        this->manifests.insert(wd);
+    }
+#endif
+}
+
+void Watcher::clear()
+{
+#ifdef __linux__
+    for (const auto &[wd, _] : this->dirs)
+        inotify_rm_watch(this->fd, wd);
+    this->dirs.clear();
+    this->manifests.clear();
+#endif
+}
+
+int Watcher::handle() const
+{
+    return this->fd;
+}
+
+std::vector<Watcher::Event> Watcher::read(int timeout_ms)
+{
+    std::vector<Event> events;
+#ifdef __linux__
+    pollfd pfd{.fd = this->fd, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0)
+        return events;
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true)
+    {
+        auto len = ::read(this->fd, buffer, sizeof(buffer));
+        if (len <= 0)
+            break;
+        for (char *ptr = buffer; ptr < buffer + len;)
+        {
+            auto event = reinterpret_cast<const inotify_event *>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // Events were lost, so the consumer must assume that anything changed.
+                events.push_back({fs::path(), true});
+                continue;
+            }
+            if (event->mask & IN_IGNORED)
+            {
+                this->dirs.erase(event->wd);
+                this->manifests.erase(event->wd);
+                continue;
+            }
+            if (!this->dirs.contains(event->wd))
+                continue;
+            const auto &[dir, recursive] = this->dirs.at(event->wd);
+            std::string name = event->len ? event->name : "";
+            auto is_manifest = name == "cup.toml";
+            if (this->manifests.contains(event->wd) && !is_manifest)
+                continue;
+            auto path = name.empty() ? dir : dir / name;
+            if (recursive && (event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+                this->watch(path, true);
+            events.push_back({path, is_manifest || (event->mask & STRUCTURAL_MASK) != 0});
+        }
+    }
+#endif
+    return events;
+}
@@ -0,0 +1,575 @@
+#include "worker.h"
+#include "plugin/host.h"
+#include "res.h"
+#include "log.h"
+#include "utils/utils.h"
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <semaphore>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using Frame = PluginHost::Frame;
+
+/// Frames larger than this are treated as a corrupted stream.
+static constexpr uint32_t MAX_FRAME = 1u << 30;
+
+static const std::set<std::string> C_SOURCES = {".c"};
+static const std::set<std::string> CXX_SOURCES = {".cpp", ".cc", ".cxx", ".c++", ".C"};
+
+static std::string read_binary(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+#ifdef __linux__
+static volatile std::sig_atomic_t stopping = 0;
+
+static sockaddr_un socket_address(const fs::path &path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.string().size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("The socket path is too long: " + path.string());
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+static bool write_frame(int fd, const Frame &frame)
+{
+    std::string buffer;
+    auto size = static_cast<uint32_t>(frame.bytes().size());
+    for (int i = 0; i < 4; i++)
+        buffer.push_back(static_cast<char>((size >> (8 * i)) & 0xff));
+    buffer += frame.bytes();
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        auto n = send(fd, buffer.data() + written, buffer.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        written += n;
+    }
+    return true;
+}
+
+static bool read_exact(int fd, char *buffer, size_t size)
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        auto n = recv(fd, buffer + done, size - done, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+static std::optional<Frame> read_frame(int fd)
+{
+    unsigned char header[4];
+    if (!read_exact(fd, reinterpret_cast<char *>(header), sizeof(header)))
+        return std::nullopt;
+    uint32_t size = header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<uint32_t>(header[3]) << 24);
+    if (size > MAX_FRAME)
+        return std::nullopt;
+    std::string data(size, '\0');
+    if (!read_exact(fd, data.data(), size))
+        return std::nullopt;
+    return Frame(std::move(data));
+}
+
+/// @brief Run a command line and wait for it.
+/// @param dir The working directory of the command, or the current one if empty.
+/// @param output The file receiving both `stdout` and `stderr`, or the inherited streams if empty.
+/// @return The exit code, 127 if the program could not be started.
+static int spawn(const std::vector<std::string> &args, const fs::path &dir = {}, const fs::path &output = {})
+{
+    std::vector<char *> argv;
+    for (const auto &arg : args)
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+    auto pid = fork();
+    if (pid == -1)
+        return 127;
+    if (pid == 0)
+    {
+        if (!dir.empty() && chdir(dir.c_str()) != 0)
+            _exit(127);
+        if (!output.empty())
+        {
+            auto fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd == -1)
+                _exit(127);
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) == -1)
+        if (errno != EINTR)
+            return 127;
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    return 128 + WTERMSIG(status);
+}
+
+/// @brief A compiler command line split into its preprocessing and its compilation.
+struct Job
+{
+    /// The arguments which only matter to the preprocessor, such as `-I` and `-MF`.
+    std::vector<std::string> preprocess;
+    /// The arguments of the compilation of the preprocessed source, compiler included.
+    std::vector<std::string> compile;
+    fs::path source;
+    fs::path object;
+    /// `.i` or `.ii`, telling the compiler that the source is preprocessed.
+    std::string extension;
+};
+
+/// @brief Split a command line such as those of the Makefile and Ninja generators.
+/// @return The job, or nothing if the command line is not a single compilation to an object.
+static std::optional<Job> split_job(const std::vector<std::string> &args)
+{
+    static const std::set<std::string> PREPROCESS_WITH_VALUE = {
+        "-D", "-U", "-I", "-include", "-imacros", "-isystem", "-iquote", "-idirafter", "-MF", "-MT", "-MQ"};
+    static const std::set<std::string> PREPROCESS = {"-MD", "-MMD", "-MP", "-MG", "-H"};
+    static const std::set<std::string> LOCAL = {"-E", "-S", "-M", "-MM", "-x", "-", "-fsyntax-only", "-MJ"};
+    static const char *const PREPROCESS_JOINED[] = {"-D", "-U", "-I", "-isystem", "-iquote", "-idirafter"};
+
+    Job job;
+    job.compile.push_back(args[0]);
+    auto compile_only = false, depfile = false, deptarget = false, deps = false;
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        const auto &arg = args[i];
+        if (LOCAL.contains(arg) || arg.starts_with("@"))
+            return std::nullopt;
+        if (arg == "-c")
+            compile_only = true;
+        else if (arg == "-o" && i + 1 < args.size())
+            job.object = args[++i];
+        else if (PREPROCESS_WITH_VALUE.contains(arg) && i + 1 < args.size())
+        {
+            depfile = depfile || arg == "-MF";
+            deptarget = deptarget || arg == "-MT" || arg == "-MQ";
+            job.preprocess.push_back(arg);
+            job.preprocess.push_back(args[++i]);
+        }
+        else if (PREPROCESS.contains(arg))
+        {
+            deps = deps || arg == "-MD" || arg == "-MMD";
+            job.preprocess.push_back(arg);
+        }
+        else if (std::any_of(std::begin(PREPROCESS_JOINED), std::end(PREPROCESS_JOINED),
+                             [&arg](const char *prefix)
+                             { return arg.starts_with(prefix); }))
+            job.preprocess.push_back(arg);
+        else if (!arg.starts_with("-") && (C_SOURCES.contains(fs::path(arg).extension().string()) ||
+                                           CXX_SOURCES.contains(fs::path(arg).extension().string())))
+        {
+            if (!job.source.empty())
+                return std::nullopt;
+            job.source = arg;
+        }
+        else
+        {
+            // Other options, such as `-O2` or `-std=c++20`, matter to both.
+            job.preprocess.push_back(arg);
+            job.compile.push_back(arg);
+        }
+    }
+    if (!compile_only || job.source.empty() || job.object.empty())
+        return std::nullopt;
+    // The defaults of `-MD` derive from `-o`, which is the preprocessed file now.
+    if (deps && !depfile)
+    {
+        auto file = job.object;
+        job.preprocess.insert(job.preprocess.end(), {"-MF", file.replace_extension(".d").string()});
+    }
+    if (deps && !deptarget)
+        job.preprocess.insert(job.preprocess.end(), {"-MT", job.object.string()});
+    job.extension = CXX_SOURCES.contains(job.source.extension().string()) ? ".ii" : ".i";
+    return job;
+}
+
+/// @brief Get the file where a worker publishes its load, next to its socket.
+static fs::path load_file(const fs::path &socket_path)
+{
+    auto file = socket_path;
+    return file.replace_extension(".load");
+}
+
+/// @brief Publish the number of queued and running jobs, and the number of slots.
+static void publish_load(int fd, uint32_t load, uint32_t slots)
+{
+    unsigned char data[8];
+    for (int i = 0; i < 4; i++)
+    {
+        data[i] = static_cast<unsigned char>((load >> (8 * i)) & 0xff);
+        data[4 + i] = static_cast<unsigned char>((slots >> (8 * i)) & 0xff);
+    }
+    // A stale load only makes the launchers choose the worker less accurately.
+    if (pwrite(fd, data, sizeof(data), 0) != static_cast<ssize_t>(sizeof(data)))
+    {
+        LOG_DEBUG("Failed to publish the load of the worker.");
+    }
+}
+
+/// @brief Read the load published by a worker.
+/// @return The share of a slot which a new job would wait for, or nothing if it is unknown.
+static std::optional<double> read_load(const fs::path &file)
+{
+    auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return std::nullopt;
+    unsigned char data[8];
+    auto n = pread(fd, data, sizeof(data), 0);
+    close(fd);
+    if (n != sizeof(data))
+        return std::nullopt;
+    uint32_t load = 0, slots = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        load |= static_cast<uint32_t>(data[i]) << (8 * i);
+        slots |= static_cast<uint32_t>(data[4 + i]) << (8 * i);
+    }
+    return static_cast<double>(load + 1) / std::max<uint32_t>(slots, 1);
+}
+
+/// @brief Connect to the least loaded worker.
+/// @return The connection, or -1 if no worker is listening.
+/// @note The load is read from the files which the workers keep up to date, so that choosing
+///       a worker costs no round trip. Workers are tried from the least loaded one.
+static int connect_worker()
+{
+    std::error_code ec;
+    if (!fs::exists(Resource::workers(), ec))
+        return -1;
+    std::vector<std::pair<double, fs::path>> candidates;
+    for (const auto &entry : fs::directory_iterator(Resource::workers(), ec))
+    {
+        if (entry.path().extension() != ".sock" || entry.path().string().size() >= sizeof(sockaddr_un::sun_path))
+            continue;
+        // A worker which has not published its load yet is tried last.
+        auto share = read_load(load_file(entry.path()));
+        candidates.emplace_back(share.value_or(std::numeric_limits<double>::max()), entry.path());
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (const auto &[_, path] : candidates)
+    {
+        auto addr = socket_address(path);
+        auto sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sock == -1)
+            continue;
+        if (::connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0)
+            return sock;
+        // Left behind by a worker which did not exit cleanly.
+        if (errno == ECONNREFUSED)
+        {
+            fs::remove(path, ec);
+            fs::remove(load_file(path), ec);
+        }
+        close(sock);
+    }
+    return -1;
+}
+
+/// @brief Write a file aside and rename it, so that the build never sees a partial object.
+static void write_atomic(const fs::path &file, const std::string &content)
+{
+    auto temp = file;
+    temp += ".tmp" + std::to_string(getpid());
+    std::ofstream(temp, std::ios::binary) << content;
+    fs::rename(temp, file);
+}
+
+/// @brief Run a job on a worker.
+/// @return The exit code of the compiler, or nothing if the job must be compiled locally.
+static std::optional<int> compile_remote(const Job &job)
+{
+    // Without a worker the job is compiled locally at once, not preprocessed twice.
+    auto sock = connect_worker();
+    if (sock == -1)
+        return std::nullopt;
+    auto preprocessed = job.object;
+    preprocessed += "." + std::to_string(getpid()) + job.extension;
+    auto preprocess = job.preprocess;
+    preprocess.insert(preprocess.begin(), job.compile[0]);
+    preprocess.insert(preprocess.end(), {"-E", job.source.string(), "-o", preprocessed.string()});
+    if (spawn(preprocess) != 0)
+    {
+        close(sock);
+        std::error_code ec;
+        fs::remove(preprocessed, ec);
+        return std::nullopt;
+    }
+    auto source = read_binary(preprocessed);
+    std::error_code ec;
+    fs::remove(preprocessed, ec);
+
+    Frame request;
+    request.put(static_cast<uint8_t>(Worker::Op::Compile))
+        .put(static_cast<uint32_t>(0))
+        .put(fs::current_path().string())
+        .put(job.compile)
+        .put(job.extension)
+        .put(source);
+    std::optional<Frame> response;
+    if (write_frame(sock, request))
+        response = read_frame(sock);
+    close(sock);
+    if (!response)
+        return std::nullopt;
+    try
+    {
+        response->get_u32();
+        if (!response->get_u8())
+            return std::nullopt;
+        auto code = static_cast<int>(response->get_u32());
+        auto diagnostics = response->get_string();
+        auto object = response->get_string();
+        std::fwrite(diagnostics.data(), 1, diagnostics.size(), stderr);
+        if (code == 0)
+            write_atomic(job.object, object);
+        return code;
+    }
+    catch (const std::exception &)
+    {
+        return std::nullopt;
+    }
+}
+
+/// @brief A connection to a client, kept open until the answers of its requests are sent.
+struct Connection
+{
+    int fd;
+    std::mutex mutex;
+
+    Connection(int fd) : fd(fd) {}
+    ~Connection() { close(fd); }
+
+    void send(const Frame &frame)
+    {
+        std::lock_guard lock(this->mutex);
+        write_frame(this->fd, frame);
+    }
+};
+
+/// @brief Compile a preprocessed source.
+/// @return The answer to the request.
+static Frame compile_job(uint32_t id, const std::string &cwd, std::vector<std::string> args,
+                           const std::string &extension, const std::string &source)
+{
+    static std::atomic<uint64_t> sequence{0};
+    auto dir = fs::temp_directory_path() / ("cup-worker-" + std::to_string(getpid()));
+    auto stem = dir / std::to_string(sequence++);
+    auto input = stem, output = stem, log = stem;
+    input += extension;
+    output += ".o";
+    log += ".log";
+
+    Frame answer;
+    answer.put(id);
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    std::ofstream(input, std::ios::binary) << source;
+    args.insert(args.end(), {"-c", input.string(), "-o", output.string()});
+    auto code = args.empty() || args[0].empty() ? 127 : spawn(args, cwd, log);
+    if (code == 127)
+        answer.put(static_cast<uint8_t>(0));
+    else
+        answer.put(static_cast<uint8_t>(1))
+            .put(static_cast<uint32_t>(code))
+            .put(read_binary(log))
+            .put(code == 0 ? read_binary(output) : std::string());
+    for (const auto &file : {input, output, log})
+        fs::remove(file, ec);
+    return answer;
+}
+#endif
+
+Worker::Worker(const cmd::Args &args) : SubCommand(args)
+{
+    this->jobs = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+    if (args.has_config("jobs") && !args.getConfig().at("jobs").empty())
+        this->jobs = std::max(std::stoi(args.getConfig().at("jobs")[0]), 1);
+}
+
+int Worker::run()
+{
+#ifdef __linux__
+    char host[256]{};
+    gethostname(host, sizeof(host) - 1);
+    // Named by host as well, since workers of several containers may share the directory.
+    auto socket_path = Resource::workers() / (std::string(host) + "-" + std::to_string(getpid()) + ".sock");
+    fs::create_directories(socket_path.parent_path());
+    auto addr = socket_address(socket_path);
+    auto sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1 ||
+        ::bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(sock, 64) != 0)
+        throw std::runtime_error("Failed to listen on " + socket_path.string());
+    this->status = open(load_file(socket_path).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (this->status == -1)
+        throw std::runtime_error("Failed to create " + load_file(socket_path).string());
+    publish_load(this->status, 0, static_cast<uint32_t>(this->jobs));
+    LOG_INFO("Worker listening on ", socket_path.string(), " with ", this->jobs, " jobs");
+
+    struct sigaction action{};
+    action.sa_handler = [](int)
+    { stopping = 1; };
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    auto ret = this->serve(sock);
+    close(sock);
+    std::error_code ec;
+    fs::remove(socket_path, ec);
+    close(this->status);
+    fs::remove(load_file(socket_path), ec);
+    fs::remove_all(fs::temp_directory_path() / ("cup-worker-" + std::to_string(getpid())), ec);
+    LOG_INFO("Worker stopped.");
+    return ret;
+#else
+    throw std::runtime_error("The worker is not supported on this platform.");
+#endif
+}
+
+int Worker::serve(int sock)
+{
+#ifdef __linux__
+    // Shared with the threads of the connections, which may outlive this call.
+    struct State
+    {
+        std::counting_semaphore<> slots;
+        /// Queued and running jobs, reported to the clients choosing a worker.
+        std::atomic<uint32_t> load{0};
+        int status;
+        uint32_t jobs;
+        /// Orders the writes of the load file, so that the last one is the current load.
+        std::mutex mutex;
+        State(int jobs, int status) : slots(jobs), status(status), jobs(jobs) {}
+
+        void change(int delta)
+        {
+            std::lock_guard lock(this->mutex);
+            this->load += delta;
+            publish_load(this->status, this->load, this->jobs);
+        }
+    };
+    auto state = std::make_shared<State>(this->jobs, this->status);
+    auto jobs = static_cast<uint32_t>(this->jobs);
+
+    auto handle = [state, jobs](std::shared_ptr<Connection> conn)
+    {
+        while (auto request = read_frame(conn->fd))
+        {
+            try
+            {
+                auto op = static_cast<Op>(request->get_u8());
+                if (op == Op::Status)
+                {
+                    conn->send(Frame().put(state->load.load()).put(jobs));
+                    continue;
+                }
+                if (op != Op::Compile)
+                    break;
+                auto id = request->get_u32();
+                auto cwd = request->get_string();
+                auto args = request->get_strings();
+                auto extension = request->get_string();
+                auto source = request->get_string();
+                // Requests are read on while earlier ones compile, and answered as they finish.
+                state->change(1);
+                std::thread([state, conn, id, cwd, args, extension, source = std::move(source)]()
+                            {
+                                state->slots.acquire();
+                                auto answer = compile_job(id, cwd, args, extension, source);
+                                state->slots.release();
+                                state->change(-1);
+                                conn->send(answer); })
+                    .detach();
+            }
+            catch (const std::exception &e)
+            {
+                LOG_WARN("Invalid request: ", e.what());
+                break;
+            }
+        }
+    };
+
+    while (!stopping)
+    {
+        // Signals may be delivered to any thread, so the flag is polled.
+        pollfd pfd{.fd = sock, .events = POLLIN, .revents = 0};
+        auto ready = poll(&pfd, 1, 200);
+        if (ready < 0 && errno != EINTR)
+            throw std::runtime_error("Failed to wait for requests.");
+        if (ready <= 0)
+            continue;
+        auto conn = ::accept4(sock, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn != -1)
+            std::thread(handle, std::make_shared<Connection>(conn)).detach();
+    }
+    // The jobs in progress are answered before the worker exits.
+    while (state->load > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+int Worker::launch(int argc, char **argv)
+{
+    if (argc < 1)
+    {
+        LOG_ERROR("No compiler to launch.");
+        return 1;
+    }
+    std::vector<std::string> args(argv, argv + argc);
+#ifdef __linux__
+    if (auto job = split_job(args))
+    {
+        try
+        {
+            if (auto code = compile_remote(*job))
+                return *code;
+        }
+        catch (const std::exception &e)
+        {
+            LOG_DEBUG("Compile locally: ", e.what());
+        }
+    }
+    return spawn(args);
+#else
+    std::string command;
+    for (const auto &arg : args)
+        command += "\"" + arg + "\" ";
+    return std::system(command.c_str());
+#endif
+}
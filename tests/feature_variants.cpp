@@ -0,0 +1,122 @@
+// A dependency required with two feature sets is generated once per feature set, each into its
+// own script, and the generated CMakeLists.txt includes the same one on every build.
+#include "build.h"
+#include "res.h"
+#include "utils/utils.h"
+#include "cup_plugin/args.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define CHECK(cond)                                                                  \
+    if (!(cond))                                                                     \
+    {                                                                                \
+        std::cerr << "Check failed at line " << __LINE__ << ": " << #cond << std::endl; \
+        return 1;                                                                    \
+    }
+
+static void write(const fs::path &file, const std::string &content)
+{
+    fs::create_directories(file.parent_path());
+    std::ofstream(file, std::ios::binary) << content;
+}
+
+static std::string read(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    return {std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+}
+
+/// @brief Build the project and get the generated CMakeLists.txt.
+static std::string build(const fs::path &project)
+{
+    std::vector<std::string> args{"cup", "build", "--dir", project.string()};
+    std::vector<char *> argv;
+    for (auto &arg : args)
+        argv.push_back(arg.data());
+    auto build = Build(cmd::Args(static_cast<int>(argv.size()), argv.data()));
+    if (build.run() != 0)
+        return "";
+    return read(Resource::build(project) / "CMakeLists.txt");
+}
+
+/// @brief Get the scripts generated for the package `a`, by content.
+static std::set<std::string> scripts_of_a(const fs::path &project)
+{
+    std::set<std::string> scripts;
+    for (const auto &entry : fs::directory_iterator(Resource::build(project) / ".cup"))
+    {
+        auto name = entry.path().filename().string();
+        if (name.starts_with("a-") && name.ends_with(".cmake") && !name.ends_with(".global.cmake"))
+            scripts.insert(read(entry.path()));
+    }
+    return scripts;
+}
+
+int main()
+{
+    auto dir = fs::temp_directory_path() /
+               ("cup-feature-variants-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    write(dir / "a" / "cup.toml", R"([project]
+name = "a"
+type = "interface"
+version = "0.1.0"
+
+[features]
+x = []
+y = []
+
+[feature.x]
+defines = ["A_X"]
+
+[feature.y]
+defines = ["A_Y"]
+)");
+    write(dir / "a" / "include" / "a" / "a.h", "#pragma once\n");
+    write(dir / "b" / "cup.toml", R"([project]
+name = "b"
+type = "interface"
+version = "0.1.0"
+
+[dependencies]
+a = { path = "../a", version = "0.1.0", features = ["y"] }
+)");
+    write(dir / "b" / "include" / "b" / "b.h", "#pragma once\n");
+    write(dir / "app" / "cup.toml", R"([project]
+name = "app"
+type = "binary"
+version = "0.1.0"
+
+[dependencies]
+a = { path = "../a", version = "0.1.0", features = ["x"] }
+b = { path = "../b", version = "0.1.0" }
+)");
+    write(dir / "app" / "src" / "main.cpp", "int main() { return 0; }\n");
+
+    auto project = dir / "app";
+    auto first = build(project);
+    CHECK(!first.empty());
+    // Each variant has its own script and fingerprint.
+    auto scripts = scripts_of_a(project);
+    CHECK(scripts.size() == 2);
+    auto blocks = 0;
+    for (const auto &entry : fs::directory_iterator(Resource::build(project) / ".cup"))
+        if (entry.path().filename().string().starts_with("a-") && entry.path().extension() == ".block")
+            blocks++;
+    CHECK(blocks == 2);
+
+    // Nothing is generated again, and the same variant is included.
+    auto second = build(project);
+    CHECK(second == first);
+    CHECK(scripts_of_a(project) == scripts);
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    std::cout << "feature_variants: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,19 @@
+
+set(MAIN_FILE "${DIR}/src/main.cpp")
+set(OUT_NAME demo)
+set(OUT_DIR "${DIR}/target/bin")
+set(UNIQUE demo_0_1_0)
+set(TEST_OUT_DIR "${DIR}/target/bin/tests")
+set(INC "${DIR}/include")
+
+set(INCLUDE_DIRS ${INC})
+
+set(UNIQUE_NAME "${OUT_NAME}_${UNIQUE}")
+
+add_executable(${UNIQUE_NAME} ${MAIN_FILE})
+target_include_directories(${UNIQUE_NAME} PRIVATE ${INCLUDE_DIRS})
+set_target_properties(${UNIQUE_NAME} PROPERTIES
+    OUTPUT_NAME ${OUT_NAME}
+    PREFIX ""
+    RUNTIME_OUTPUT_DIRECTORY ${OUT_DIR})
+
@@ -0,0 +1,13 @@
+
+set(EXPORT_NAME demo)
+set(IS_DEP OFF)
+set(UNIQUE demo_0_1_0)
+set(TEST_OUT_DIR "${DIR}/target/bin/tests")
+set(EXAMPLE_OUT_DIR "${DIR}/target/bin/examples")
+set(INC "${DIR}/include")
+
+set(INCLUDE_DIRS ${INC})
+
+add_library(${EXPORT_NAME} INTERFACE)
+target_include_directories(${EXPORT_NAME} INTERFACE ${INCLUDE_DIRS})
+
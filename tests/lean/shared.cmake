@@ -0,0 +1,40 @@
+
+set(EXPORT_NAME demo)
+set(IS_DEP OFF)
+set(UNIQUE demo_0_1_0)
+set(TEST_OUT_DIR "${DIR}/target/bin/tests")
+set(EXAMPLE_OUT_DIR "${DIR}/target/bin/examples")
+set(INC "${DIR}/include")
+set(EXPORT_INC "${DIR}/export")
+set(SOURCES "${DIR}/src/demo.cpp")
+set(VISIBILITY PUBLIC)
+set(LIB_OUT_DIR "${DIR}/target/lib")
+set(DLL_OUT_DIR "${DIR}/target/dll")
+
+set(INCLUDE_DIRS ${EXPORT_INC})
+
+add_library(${EXPORT_NAME} SHARED ${SOURCES})
+target_compile_features(${EXPORT_NAME} ${VISIBILITY})
+target_include_directories(${EXPORT_NAME} ${VISIBILITY} ${INCLUDE_DIRS})
+target_include_directories(${EXPORT_NAME} PUBLIC ${EXPORT_INC})
+target_include_directories(${EXPORT_NAME} PRIVATE ${INC})
+target_link_directories(${EXPORT_NAME} ${VISIBILITY})
+target_link_libraries(${EXPORT_NAME} ${VISIBILITY})
+target_compile_options(${EXPORT_NAME} ${VISIBILITY})
+target_link_options(${EXPORT_NAME} ${VISIBILITY})
+set_target_properties(${EXPORT_NAME} PROPERTIES
+    OUTPUT_NAME ${EXPORT_NAME}
+    ARCHIVE_OUTPUT_DIRECTORY ${LIB_OUT_DIR}
+    RUNTIME_OUTPUT_DIRECTORY ${DLL_OUT_DIR})
+if(CUP_IFS_COMMAND AND CMAKE_EXECUTABLE_FORMAT STREQUAL "ELF" AND CMAKE_GENERATOR MATCHES "Makefiles|Ninja")
+    set(IFS_FILE "${CMAKE_BINARY_DIR}/ifs/${UNIQUE}.ifs")
+    if(NOT EXISTS ${IFS_FILE})
+        file(WRITE ${IFS_FILE} "")
+    endif()
+    add_custom_command(TARGET ${EXPORT_NAME} POST_BUILD
+        COMMAND ${CUP_IFS_COMMAND} $<TARGET_FILE:${EXPORT_NAME}> ${IFS_FILE}
+        BYPRODUCTS ${IFS_FILE}
+        VERBATIM)
+    set_target_properties(${EXPORT_NAME} PROPERTIES INTERFACE_LINK_DEPENDS ${IFS_FILE})
+endif()
+
@@ -0,0 +1,27 @@
+
+set(EXPORT_NAME demo)
+set(IS_DEP OFF)
+set(UNIQUE demo_0_1_0)
+set(TEST_OUT_DIR "${DIR}/target/bin/tests")
+set(EXAMPLE_OUT_DIR "${DIR}/target/bin/examples")
+set(INC "${DIR}/include")
+set(EXPORT_INC "${DIR}/export")
+set(SOURCES "${DIR}/src/demo.cpp")
+set(VISIBILITY PUBLIC)
+set(OUT_DIR "${DIR}/target/lib")
+
+set(INCLUDE_DIRS ${EXPORT_INC})
+
+add_library(${EXPORT_NAME} STATIC ${SOURCES})
+target_compile_features(${EXPORT_NAME} ${VISIBILITY})
+target_include_directories(${EXPORT_NAME} ${VISIBILITY} ${INCLUDE_DIRS})
+target_include_directories(${EXPORT_NAME} PUBLIC ${EXPORT_INC})
+target_include_directories(${EXPORT_NAME} PRIVATE ${INC})
+target_link_directories(${EXPORT_NAME} ${VISIBILITY})
+target_link_libraries(${EXPORT_NAME} ${VISIBILITY})
+target_compile_options(${EXPORT_NAME} ${VISIBILITY})
+target_link_options(${EXPORT_NAME} ${VISIBILITY})
+set_target_properties(${EXPORT_NAME} PROPERTIES
+    OUTPUT_NAME ${EXPORT_NAME}
+    ARCHIVE_OUTPUT_DIRECTORY ${OUT_DIR})
+
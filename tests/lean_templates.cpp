@@ -0,0 +1,93 @@
+// The lean script of each built-in plugin, for a package with no optional configuration, is
+// compared with the one recorded under `tests/lean/`, so that an edit of a template which the
+// lean mode no longer reduces shows up. The directory of the package is written as `${DIR}`.
+#include "plugin/built-in/binary.h"
+#include "plugin/built-in/static.h"
+#include "plugin/built-in/shared.h"
+#include "plugin/built-in/module.h"
+#include "plugin/built-in/interface.h"
+#include "plugin/built-in/lean.h"
+#include "utils/utils.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static void write(const fs::path &file, const std::string &content)
+{
+    fs::create_directories(file.parent_path());
+    std::ofstream(file, std::ios::binary) << content;
+}
+
+static std::string read(const fs::path &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    return {std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+}
+
+struct Case
+{
+    std::string type;
+    std::unique_ptr<IPlugin> plugin;
+    /// The sources of the package, besides its manifest.
+    std::vector<std::string> files;
+};
+
+int main()
+{
+    auto dir = fs::temp_directory_path() /
+               ("cup-lean-templates-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    auto expected_dir = fs::path(__FILE__).parent_path() / "lean";
+    std::vector<Case> cases;
+    cases.push_back({"binary", std::make_unique<BinaryPlugin>(), {"src/main.cpp"}});
+    cases.push_back({"static", std::make_unique<StaticPlugin>(), {"src/demo.cpp", "export/demo/demo.h"}});
+    cases.push_back({"shared", std::make_unique<SharedPlugin>(), {"src/demo.cpp", "export/demo/demo.h"}});
+    cases.push_back({"module", std::make_unique<ModulePlugin>(), {"src/demo.cpp"}});
+    cases.push_back({"interface", std::make_unique<InterfacePlugin>(), {"include/demo/demo.h"}});
+
+    auto failed = 0;
+    for (const auto &[type, plugin, files] : cases)
+    {
+        auto package = dir / type;
+        write(package / "cup.toml", "[project]\nname = \"demo\"\ntype = \"" + type +
+                                        "\"\nversion = \"0.1.0\"\n\n[build]\ncodegen = \"lean\"\n");
+        for (const auto &file : files)
+            write(package / file, "\n");
+        set_lean(package, true);
+        CMakeContext ctx{
+            .name = "demo",
+            .cmake_version = {3, 10},
+            .current_dir = package,
+            .root_dir = package,
+            .features = {},
+            .dependencies = {},
+        };
+        auto script = plugin->gen_cmake(ctx, false);
+        if (script.is_error())
+        {
+            std::cerr << type << ": " << script.error() << std::endl;
+            failed++;
+            continue;
+        }
+        auto actual = replace(script.ok(), package.generic_string(), "${DIR}");
+        auto expected = read(expected_dir / (type + ".cmake"));
+        if (actual != expected)
+        {
+            std::cerr << type << ": the lean script differs from " << (expected_dir / (type + ".cmake")).string()
+                      << ", got:\n"
+                      << actual << std::endl;
+            failed++;
+        }
+    }
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    if (failed)
+        return 1;
+    std::cout << "lean_templates: ok" << std::endl;
+    return 0;
+}